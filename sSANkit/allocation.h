@@ -0,0 +1,55 @@
+/**
+ *	@file
+ *	Heap allocation macro of the library, with an optional debug counter.
+ *
+ *	@author Santhosbaala RS
+ *	@copyright 2012 64cloud
+ *	@version 0.1
+ */
+
+#ifndef sSANkit_allocation_h
+#define sSANkit_allocation_h
+
+#include <stdlib.h>
+
+/**
+ *	Build with SSK_COUNT_ALLOCATIONS set to 1 to count every heap allocation the library makes in
+ *	sskHeapAllocationCount. The semantic analyzer then asserts that no ply allocates. The counter
+ *	is thread local, each thread counts its own allocations, so the assertion also holds while
+ *	sskSemanticAnalyzeInParallel() annotates on several threads.
+ */
+#ifndef SSK_COUNT_ALLOCATIONS
+#define SSK_COUNT_ALLOCATIONS (0)
+#endif
+
+/** Storage class for thread local variables, C11 or the older GCC extension. */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define SSK_THREAD_LOCAL _Thread_local
+#else
+#define SSK_THREAD_LOCAL __thread
+#endif
+
+/**
+ *	malloc() variant for over-aligned types, such as those holding an sskPosition. The memory is
+ *	released with free().
+ *
+ *	@param alignment The alignment, a power of two multiple of sizeof(void *).
+ *	@param size The number of bytes to allocate.
+ *
+ *	@return The allocated memory or NULL on failure.
+ */
+static inline void * _sskAlignedMalloc(size_t alignment, size_t size) {
+	void * memory = NULL;
+	return (posix_memalign(&memory, alignment, size) == 0) ? memory : NULL;
+}
+
+#if SSK_COUNT_ALLOCATIONS
+extern SSK_THREAD_LOCAL unsigned long sskHeapAllocationCount;	/** Number of heap allocations made by the library on this thread so far. */
+#define SSK_MALLOC(size) (sskHeapAllocationCount++, malloc(size))
+#define SSK_ALIGNED_MALLOC(alignment, size) (sskHeapAllocationCount++, _sskAlignedMalloc((alignment), (size)))
+#else
+#define SSK_MALLOC(size) malloc(size)
+#define SSK_ALIGNED_MALLOC(alignment, size) _sskAlignedMalloc((alignment), (size))
+#endif
+
+#endif
@@ -8,10 +8,20 @@
  */
 
 #include "bitboard.h"
+#include "allocation.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
+
+/** PEXT indexing needs BMI2, which is only probed for on x86-64 with GCC or Clang. */
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH && defined(__x86_64__) && defined(__GNUC__)
+#define SSK_HAS_PEXT_BACKEND 1
+#include <immintrin.h>
+#else
+#define SSK_HAS_PEXT_BACKEND 0
+#endif
 
 #pragma mark - Masking Functions
 
@@ -260,7 +270,11 @@ sskBitmap sskBitmapWithWestRank(sskChessSquare squareIndex) {
 
 #pragma mark - BitScan Functions
 
-unsigned short sskCountBits(sskBitmap bitmap) {
+#if SSK_RUNTIME_POPCNT
+kBool sskCPUHasPopcount = kFalse;
+#endif
+
+unsigned short sskCountBitsPortable(sskBitmap bitmap) {
 	/// MIT HAKMEM algorithm, @link http://graphics.stanford.edu/~seander/bithacks.html
 	
 	static const sskBitmap  M1 = 0x5555555555555555;  // 1 zero,  1 one ...
@@ -280,9 +294,9 @@ unsigned short sskCountBits(sskBitmap bitmap) {
 	return (unsigned short)bitmap;
 }
 
-unsigned short sskFirstOneIndex(sskBitmap bitmap) {
+unsigned short sskFirstOneIndexPortable(sskBitmap bitmap) {
 	/// De Bruijn Multiplication, @link http://chessprogramming.wikispaces.com/BitScan
-	// don't use this if bitmap = 0
+	// bitmap = 0 returns 63(INDEX64[0])
 	
 	static const int INDEX64[64] = {
 		63,  0, 58,  1, 59, 47, 53,  2,
@@ -299,10 +313,10 @@ unsigned short sskFirstOneIndex(sskBitmap bitmap) {
 	return INDEX64[((bitmap & -bitmap) * DEBRUIJN64) >> 58];
 }
 
-unsigned short sskLastOneIndex(sskBitmap bitmap) {
+unsigned short sskLastOneIndexPortable(sskBitmap bitmap) {
     // this is Eugene Nalimov's bitScanReverse
 	// use sskFirstOneIndex if you can, it is faster than sskLastOneIndex.
-	// don't use this if bitmap = 0
+	// bitmap = 0 returns 0(MS1BTABLE[0])
 	
 	// Nalimoves MSB 1 Bit Table.
 	static const int MS1BTABLE[256] = {
@@ -346,27 +360,718 @@ unsigned short sskLastOneIndex(sskBitmap bitmap) {
 	return result + MS1BTABLE[bitmap];
 }
 
+#pragma mark - Sliding Attack Functions
+
+#if SSK_SLIDING_ATTACKS != SSK_SLIDING_ATTACKS_RAY
+/** Magic multipliers for rooks, one per square(a1-h8). Found by a sparse random search against the relevant occupancy masks. */
+static const sskBitmap _sskRookMagics[64] = {
+	0x1080004008801020, 0x0840092002c03000, 0x1900200010400900, 0x0880100008000480,
+	0x4200100420080200, 0x8100020100080400, 0x0200040110886200, 0x0200008040220411,
+	0x0404800084400220, 0x0000401000402000, 0x0086001081220440, 0x0408800800100280,
+	0x000a001201040820, 0x8848800200840080, 0x4001000100040200, 0x0442000102105084,
+	0x9080010020804100, 0x0040404000201009, 0x0000808010002009, 0x2200090021d00100,
+	0x0008008008040080, 0x0004004002010040, 0x0011040008015042, 0x00000a0001768104,
+	0x0000800080204009, 0x2010004140002001, 0x9800200280100080, 0x1000100080080080,
+	0x0442000a00049020, 0x2100040080020080, 0x0800120400900148, 0x0010040a00128541,
+	0x2800804000800030, 0x1010002000400041, 0x4000200011004100, 0x0610008410800800,
+	0x0400802402800800, 0xc100020080800400, 0x0002000802000401, 0x0182085882000401,
+	0x0220204000808000, 0x2860100040024022, 0x0001002004110040, 0x99101042000a0020,
+	0x0004080004008080, 0x0010040002008080, 0x2012004881020004, 0x8300842444820011,
+	0x0088403882010200, 0x0820400080210100, 0x0110910040a00300, 0x0801100280080480,
+	0x0242009008200600, 0x1002000489500200, 0x0040800200010080, 0x0091800041000080,
+	0x0000209300488001, 0x04c1002414824001, 0x020020000b001041, 0x7000100004200901,
+	0x8002002004100802, 0x30010002084c0007, 0x0888221800813004, 0x4000002840840112
+};
+
+/** Magic multipliers for bishops, one per square(a1-h8). */
+static const sskBitmap _sskBishopMagics[64] = {
+	0xa010041108003100, 0x006082020a002900, 0x6810010619200000, 0x08281a0520000408,
+	0x0001104001000400, 0x0018901008048400, 0x00040a0210245280, 0x000200210808a402,
+	0x9140048410821200, 0x0800091010820041, 0x20504804832202c0, 0x0100091401081000,
+	0x8021011140000012, 0x0810020804450400, 0x208b0542109008a2, 0x0080084a08040204,
+	0x0040e2a80811244c, 0x2505022008008108, 0x0430220100420040, 0x010a040420220040,
+	0x1105000290400000, 0x0093001200822120, 0x4000a62048043004, 0x280120048a015004,
+	0x006090002a020814, 0x44042000240800d0, 0x01102800040a4400, 0x1004080080220040,
+	0x0001001011004024, 0x0010044000805040, 0x0914041200820100, 0x0004821012821480,
+	0x0024040500c05021, 0x0088611002080200, 0x0116080a00040020, 0x4000020080080080,
+	0x2450450140840040, 0x0000880201484100, 0x0222020404020092, 0x8081110600002e00,
+	0x2842101105000801, 0x1100809008001025, 0x00020202221c0400, 0x0422014022009020,
+	0x0210046102100c00, 0xc004008082029102, 0x00aa461801101200, 0x0404080080201108,
+	0x020542108c205002, 0x0410544804100100, 0x0040910841100000, 0x0400200042021100,
+	0x00004204850400c0, 0x0200100410a42102, 0x1040020801210102, 0x0805040410420000,
+	0x2884804130100200, 0x800c262201242000, 0x1058000194108800, 0x0014221054420204,
+	0x0104000012a02200, 0x0200881003300100, 0x0140400202840100, 0x0402020801010201
+};
+
+/** Per square data for a magic lookup: relevant occupancy mask, shift and the square's slice of the attack table. */
+typedef struct _sskMagicEntry {
+	sskBitmap mask;			/** relevant occupancy, the ray squares excluding the board edge */
+	sskBitmap magic;		/** magic multiplier */
+	sskBitmap * attacks;	/** attack sets of this square, indexed by the magic hash */
+	sskBitmap * pextAttacks;	/** attack sets of this square, indexed by PEXT of the occupancy */
+	unsigned int shift;		/** 64 - number of bits in mask */
+} _sskMagicEntry;
+
+static _sskMagicEntry _sskRookMagicEntries[64];
+static _sskMagicEntry _sskBishopMagicEntries[64];
+static sskBitmap _sskRookAttackTable[102400];	// sum of 2^bits(mask) over all squares
+static sskBitmap _sskBishopAttackTable[5248];
+#endif
+
+static sskBitmap _sskSquaresBetween[64][64];	// squares strictly between two aligned squares
+static sskBitmap _sskSquaresInLine[64][64];	// whole rank, file or diagonal through two aligned squares
+
+static sskZobristKey _sskZobristPieceKeys[16][64];	// by 4-bit piece code, rows of unused codes stay 0
+static sskZobristKey _sskZobristCastlingKeys[4][8];	// by xFEN castling slot and rook file
+static sskZobristKey _sskZobristEnPassantKeys[8];	// by file of the target square
+static sskZobristKey _sskZobristBlackToMoveKey;
+
+static sskMaterialClass _sskMaterialClasses[192 * 192];	// by the material index of both sides
+
+#if SSK_HAS_PEXT_BACKEND
+// Same sizes as the magic tables, the magics are all minimal(2^bits(mask) entries per square).
+static sskBitmap _sskRookPextAttackTable[102400];
+static sskBitmap _sskBishopPextAttackTable[5248];
+#endif
+
+/** Reference rook attacks computed with the ray lookups, one bitscan per direction. */
+static sskBitmap _sskRookAttacksRay(sskChessSquare squareIndex, sskBitmap occupied) {
+	sskBitmap attacks = SSK_EMPTY_BITMAP;
+	
+	// sskFirstOneIndex(0) = 63 and sskLastOneIndex(0) = 0 yield empty rays, so a
+	// direction without blockers keeps its full ray after the XOR.
+	attacks |= sskBitmapWithEastRank(squareIndex) ^ sskBitmapWithEastRank(sskFirstOneIndex(sskBitmapWithEastRank(squareIndex) & occupied));
+	attacks |= sskBitmapWithWestRank(squareIndex) ^ sskBitmapWithWestRank(sskLastOneIndex(sskBitmapWithWestRank(squareIndex) & occupied));
+	attacks |= sskBitmapWithNorthFile(squareIndex) ^ sskBitmapWithNorthFile(sskFirstOneIndex(sskBitmapWithNorthFile(squareIndex) & occupied));
+	attacks |= sskBitmapWithSouthFile(squareIndex) ^ sskBitmapWithSouthFile(sskLastOneIndex(sskBitmapWithSouthFile(squareIndex) & occupied));
+	
+	return attacks;
+}
+
+/** Reference bishop attacks computed with the ray lookups, one bitscan per direction. */
+static sskBitmap _sskBishopAttacksRay(sskChessSquare squareIndex, sskBitmap occupied) {
+	sskBitmap attacks = SSK_EMPTY_BITMAP;
+	
+	attacks |= sskBitmapWithNorthEastDiagonal(squareIndex) ^ sskBitmapWithNorthEastDiagonal(sskFirstOneIndex(sskBitmapWithNorthEastDiagonal(squareIndex) & occupied));
+	attacks |= sskBitmapWithNorthWestDiagonal(squareIndex) ^ sskBitmapWithNorthWestDiagonal(sskFirstOneIndex(sskBitmapWithNorthWestDiagonal(squareIndex) & occupied));
+	attacks |= sskBitmapWithSouthEastDiagonal(squareIndex) ^ sskBitmapWithSouthEastDiagonal(sskLastOneIndex(sskBitmapWithSouthEastDiagonal(squareIndex) & occupied));
+	attacks |= sskBitmapWithSouthWestDiagonal(squareIndex) ^ sskBitmapWithSouthWestDiagonal(sskLastOneIndex(sskBitmapWithSouthWestDiagonal(squareIndex) & occupied));
+	
+	return attacks;
+}
+
+#if SSK_SLIDING_ATTACKS != SSK_SLIDING_ATTACKS_RAY
+static sskBitmap _sskRookAttacksMagic(sskChessSquare squareIndex, sskBitmap occupied) {
+	const _sskMagicEntry * entry = &_sskRookMagicEntries[squareIndex];
+	return entry->attacks[((occupied & entry->mask) * entry->magic) >> entry->shift];
+}
+
+static sskBitmap _sskBishopAttacksMagic(sskChessSquare squareIndex, sskBitmap occupied) {
+	const _sskMagicEntry * entry = &_sskBishopMagicEntries[squareIndex];
+	return entry->attacks[((occupied & entry->mask) * entry->magic) >> entry->shift];
+}
+#endif
+
+#if SSK_HAS_PEXT_BACKEND
+__attribute__((target("bmi2"))) static sskBitmap _sskRookAttacksPext(sskChessSquare squareIndex, sskBitmap occupied) {
+	const _sskMagicEntry * entry = &_sskRookMagicEntries[squareIndex];
+	return entry->pextAttacks[_pext_u64(occupied, entry->mask)];
+}
+
+__attribute__((target("bmi2"))) static sskBitmap _sskBishopAttacksPext(sskChessSquare squareIndex, sskBitmap occupied) {
+	const _sskMagicEntry * entry = &_sskBishopMagicEntries[squareIndex];
+	return entry->pextAttacks[_pext_u64(occupied, entry->mask)];
+}
+
+/** Returns kTrue if the CPU executing this code supports the BMI2 instructions. */
+static kBool _sskCPUSupportsBMI2(void) {
+	// Needed when called from a constructor, before the runtime has probed the CPU itself.
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("bmi2") ? kTrue : kFalse;
+}
+
+/**
+ *	Fills the PEXT attack table of one slider type from its already initialized magic entries.
+ *	The Carry-Rippler enumeration visits the subsets of a mask in the order of their PEXT
+ *	index(0, 1, 2...), so the table is filled sequentially without executing PEXT.
+ */
+static void _sskInitPextEntries(_sskMagicEntry entries[64], sskBitmap * table) {
+	sskBitmap * next = table, subset;
+	sskChessSquare square;
+	
+	for (square = 0; square < 64; square++) {
+		entries[square].pextAttacks = next;
+		
+		subset = SSK_EMPTY_BITMAP;
+		do {
+			*next++ = entries[square].attacks[(subset * entries[square].magic) >> entries[square].shift];
+			subset = (subset - entries[square].mask) & entries[square].mask;
+		} while (subset);
+	}
+}
+#endif
+
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH
+typedef sskBitmap (* _sskSlidingAttacksFunction)(sskChessSquare squareIndex, sskBitmap occupied);
+
+// The ray scan needs no tables, so it is safe to call before sskInitBitboards() picks the backend.
+static sskSlidingAttacksBackend _sskSlidingAttacksBackend = sskSlidingAttacksBackendRay;
+static _sskSlidingAttacksFunction _sskRookAttacks = _sskRookAttacksRay;
+static _sskSlidingAttacksFunction _sskBishopAttacks = _sskBishopAttacksRay;
+#endif
+
+#if SSK_SLIDING_ATTACKS != SSK_SLIDING_ATTACKS_RAY
+/**
+ *	Fills the magic entries and the attack table of one slider type. Every subset of the relevant
+ *	mask is enumerated(Carry-Rippler) and its ray attacks are stored under the magic index.
+ *	Returns kFalse if two subsets with different attacks collide on the same index.
+ */
+static kBool _sskInitMagicEntries(_sskMagicEntry entries[64], sskBitmap * table, const sskBitmap magics[64], kBool isBishop) {
+	static const sskBitmap edgeFiles = 0x8181818181818181, edgeRanks = 0xff000000000000ff;
+	sskBitmap * next = table, subset, attacks, * slot;
+	sskChessSquare square;
+	unsigned int size, i;
+	
+	for (square = 0; square < 64; square++) {
+		if (isBishop) {
+			entries[square].mask = _sskBishopAttacksRay(square, SSK_EMPTY_BITMAP) & ~(edgeFiles | edgeRanks);
+		} else {
+			// The edges are dropped per direction, a rook on the a-file still needs a2-a7.
+			entries[square].mask = ((sskBitmapWithNorthFile(square) | sskBitmapWithSouthFile(square)) & ~edgeRanks) |
+								   ((sskBitmapWithEastRank(square) | sskBitmapWithWestRank(square)) & ~edgeFiles);
+		}
+		entries[square].magic = magics[square];
+		entries[square].shift = 64 - sskCountBits(entries[square].mask);
+		entries[square].attacks = next;
+		
+		size = 1U << (64 - entries[square].shift);
+		for (i = 0; i < size; i++) next[i] = SSK_EMPTY_BITMAP;
+		
+		subset = SSK_EMPTY_BITMAP;
+		do {
+			attacks = isBishop ? _sskBishopAttacksRay(square, subset) : _sskRookAttacksRay(square, subset);
+			slot = &entries[square].attacks[(subset * entries[square].magic) >> entries[square].shift];
+			
+			// Every attack set contains at least one square, so an empty slot is unused.
+			if (*slot != SSK_EMPTY_BITMAP && *slot != attacks) return kFalse;
+			*slot = attacks;
+			
+			subset = (subset - entries[square].mask) & entries[square].mask;
+		} while (subset);
+		
+		next += size;
+	}
+	
+	return kTrue;
+}
+#endif
+
+/** Fills the between and line tables from the ray scans, squares that are not aligned stay empty. */
+static void _sskInitLineTables(void) {
+	sskChessSquare from, to;
+	sskBitmap fromBitmap, toBitmap;
+	
+	for (from = 0; from < 64; from++) {
+		fromBitmap = SSK_BITMAP_SET_SQUARE_IDX(from);
+		for (to = 0; to < 64; to++) {
+			toBitmap = SSK_BITMAP_SET_SQUARE_IDX(to);
+			
+			if (_sskRookAttacksRay(from, SSK_EMPTY_BITMAP) & toBitmap) {
+				_sskSquaresBetween[from][to] = _sskRookAttacksRay(from, toBitmap) & _sskRookAttacksRay(to, fromBitmap);
+				_sskSquaresInLine[from][to] = (_sskRookAttacksRay(from, SSK_EMPTY_BITMAP) & _sskRookAttacksRay(to, SSK_EMPTY_BITMAP)) | fromBitmap | toBitmap;
+			} else if (_sskBishopAttacksRay(from, SSK_EMPTY_BITMAP) & toBitmap) {
+				_sskSquaresBetween[from][to] = _sskBishopAttacksRay(from, toBitmap) & _sskBishopAttacksRay(to, fromBitmap);
+				_sskSquaresInLine[from][to] = (_sskBishopAttacksRay(from, SSK_EMPTY_BITMAP) & _sskBishopAttacksRay(to, SSK_EMPTY_BITMAP)) | fromBitmap | toBitmap;
+			}
+		}
+	}
+}
+
+/** SplitMix64 step, used to draw the Zobrist keys. */
+static sskZobristKey _sskNextZobristKey(sskZobristKey * state) {
+	sskZobristKey key = (*state += 0x9E3779B97F4A7C15);
+	
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EB;
+	return key ^ (key >> 31);
+}
+
+/** Draws the Zobrist keys from a fixed seed, they must not change between builds or runs. */
+static void _sskInitZobristKeys(void) {
+	sskZobristKey state = 0x2C1B3C6D5E7F8091;
+	sskChessColor color;
+	sskChessPiece piece;
+	int i, j;
+	
+	for (color = sskChessColorWhite; color <= sskChessColorBlack; color++) {
+		for (piece = sskChessPiecePawn; piece <= sskChessPieceKnight; piece++) {
+			for (i = 0; i < 64; i++) _sskZobristPieceKeys[(color << 3) | piece][i] = _sskNextZobristKey(&state);
+		}
+	}
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 8; j++) _sskZobristCastlingKeys[i][j] = _sskNextZobristKey(&state);
+	}
+	for (j = 0; j < 8; j++) _sskZobristEnPassantKeys[j] = _sskNextZobristKey(&state);
+	_sskZobristBlackToMoveKey = _sskNextZobristKey(&state);
+}
+
+/**
+ *	Material index of one side, 0-191: pawns present(2) x knights 0/1/2+(3) x light bishops
+ *	present(2) x dark bishops present(2) x rooks present(2) x queens present(2) x more than two
+ *	pieces(2). It keeps just what the classification looks at.
+ */
+static unsigned int _sskMaterialSideIndex(sskMaterialKey materialKey, sskChessColor color) {
+	unsigned int knights = SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotKnight);
+	unsigned int pieces = knights + SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotLightBishop) + SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotDarkBishop) +
+						  SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotRook) + SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotQueen);
+	
+	return (SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotPawn) ? 1 : 0) +
+		   ((knights > 2) ? 2 : knights) * 2 +
+		   (SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotLightBishop) ? 6 : 0) +
+		   (SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotDarkBishop) ? 12 : 0) +
+		   (SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotRook) ? 24 : 0) +
+		   (SSK_GET_MATERIAL_COUNT(materialKey, color, sskMaterialSlotQueen) ? 48 : 0) +
+		   ((pieces > 2) ? 96 : 0);
+}
+
+/** Classifies every pair of side indexes, the side index digits are unpacked again. */
+static void _sskInitMaterialClasses(void) {
+	unsigned int white, black, side, pawns = 0, knights = 0, lightBishops = 0, darkBishops = 0, rooks = 0, queens = 0, isCrowded = 0;
+	sskEndgameClass endgameClass;
+	
+	for (white = 0; white < 192; white++) {
+		for (black = 0; black < 192; black++) {
+			pawns = knights = lightBishops = darkBishops = rooks = queens = isCrowded = 0;
+			for (side = 0; side < 2; side++) {
+				unsigned int sideIndex = side ? black : white;
+				pawns += sideIndex % 2;
+				knights += (sideIndex / 2) % 3;
+				lightBishops += (sideIndex / 6) % 2;
+				darkBishops += (sideIndex / 12) % 2;
+				rooks += (sideIndex / 24) % 2;
+				queens += (sideIndex / 48) % 2;
+				isCrowded += (sideIndex / 96) % 2;
+			}
+			
+			if (isCrowded) {
+				endgameClass = sskEndgameClassNone;
+			} else if (queens) {
+				endgameClass = sskEndgameClassQueen;
+			} else if (rooks) {
+				endgameClass = (knights || lightBishops || darkBishops) ? sskEndgameClassRookAndMinor : sskEndgameClassRook;
+			} else {
+				endgameClass = (knights || lightBishops || darkBishops) ? sskEndgameClassMinorPiece : sskEndgameClassPawn;
+			}
+			
+			_sskMaterialClasses[white * 192 + black] = endgameClass;
+			
+			// Without pawns and majors: a lone knight, or bishops on one square color only.
+			if (!pawns && !rooks && !queens &&
+				((knights == 1 && !lightBishops && !darkBishops) || (!knights && !(lightBishops && darkBishops)))) {
+				_sskMaterialClasses[white * 192 + black] |= SSK_MATERIAL_CLASS_DEAD_FLAG;
+			}
+		}
+	}
+}
+
+kBool sskInitBitboards(void) {
+	static kBool isInitialized = kFalse, isVerified = kFalse;
+	
+	if (isInitialized) return isVerified;
+	
+#if SSK_RUNTIME_POPCNT
+	__builtin_cpu_init();
+	sskCPUHasPopcount = __builtin_cpu_supports("popcnt") ? kTrue : kFalse;
+#endif
+	
+	_sskInitLineTables();
+	_sskInitZobristKeys();
+	_sskInitMaterialClasses();
+	
+#if SSK_SLIDING_ATTACKS != SSK_SLIDING_ATTACKS_RAY
+	isVerified = _sskInitMagicEntries(_sskRookMagicEntries, _sskRookAttackTable, _sskRookMagics, kFalse) &&
+				 _sskInitMagicEntries(_sskBishopMagicEntries, _sskBishopAttackTable, _sskBishopMagics, kTrue);
+#else
+	isVerified = kTrue;		// No tables to build, the ray scan is used directly
+#endif
+	isInitialized = kTrue;
+	
+#if SSK_HAS_PEXT_BACKEND
+	if (isVerified && _sskCPUSupportsBMI2()) {
+		_sskInitPextEntries(_sskRookMagicEntries, _sskRookPextAttackTable);
+		_sskInitPextEntries(_sskBishopMagicEntries, _sskBishopPextAttackTable);
+	}
+#endif
+	
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH
+	// Best available backend first, the ray scan is the last resort if the tables are broken.
+	if (!sskSetSlidingAttacksBackend(sskSlidingAttacksBackendPext) &&
+		!sskSetSlidingAttacksBackend(sskSlidingAttacksBackendMagic)) {
+		sskSetSlidingAttacksBackend(sskSlidingAttacksBackendRay);
+	}
+#endif
+	
+	return isVerified;
+}
+
+#if defined(__GNUC__)
+/** Builds the lookup tables at load time so that the attack functions can be used right away. */
+__attribute__((constructor)) static void _sskInitBitboardsAtLoad(void) {
+	sskInitBitboards();
+}
+#endif
+
+sskSlidingAttacksBackend sskCurrentSlidingAttacksBackend(void) {
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH
+	sskInitBitboards();
+	return _sskSlidingAttacksBackend;
+#elif SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_MAGIC
+	return sskSlidingAttacksBackendMagic;
+#else
+	return sskSlidingAttacksBackendRay;
+#endif
+}
+
+kBool sskSetSlidingAttacksBackend(sskSlidingAttacksBackend backend) {
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH
+	switch (backend) {
+		case sskSlidingAttacksBackendRay:
+			_sskRookAttacks = _sskRookAttacksRay;
+			_sskBishopAttacks = _sskBishopAttacksRay;
+			break;
+			
+		case sskSlidingAttacksBackendMagic:
+			if (!sskInitBitboards()) return kFalse;
+			_sskRookAttacks = _sskRookAttacksMagic;
+			_sskBishopAttacks = _sskBishopAttacksMagic;
+			break;
+			
+#if SSK_HAS_PEXT_BACKEND
+		case sskSlidingAttacksBackendPext:
+			// The PEXT tables are only built when the CPU supports BMI2.
+			if (!sskInitBitboards() || _sskRookMagicEntries[0].pextAttacks == NULL) return kFalse;
+			_sskRookAttacks = _sskRookAttacksPext;
+			_sskBishopAttacks = _sskBishopAttacksPext;
+			break;
+#endif
+			
+		default:
+			return kFalse;
+	}
+	
+	_sskSlidingAttacksBackend = backend;
+	return kTrue;
+#else
+	return (backend == sskCurrentSlidingAttacksBackend()) ? kTrue : kFalse;
+#endif
+}
+
+kBool sskVerifySlidingAttacks(unsigned int samplesPerSquare) {
+	sskBitmap seed = 0x9E3779B97F4A7C15, occupied;
+	sskChessSquare square;
+	unsigned int i;
+	
+	if (!sskInitBitboards()) return kFalse;
+	
+	for (square = 0; square < 64; square++) {
+		for (i = 0; i < samplesPerSquare; i++) {
+			// xorshift64*, the sparse AND of three draws gives realistic blocker densities.
+			seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+			occupied = seed * 0x2545F4914F6CDD1D;
+			seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+			occupied &= seed * 0x2545F4914F6CDD1D;
+			if (i & 1) occupied |= seed;
+			
+			if (sskBitmapWithRookAttacks(square, occupied) != _sskRookAttacksRay(square, occupied)) return kFalse;
+			if (sskBitmapWithBishopAttacks(square, occupied) != _sskBishopAttacksRay(square, occupied)) return kFalse;
+			
+			// The set-wise fills must agree for a lone slider as well.
+			if (sskBitmapWithRookSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(square), occupied) != _sskRookAttacksRay(square, occupied)) return kFalse;
+			if (sskBitmapWithBishopSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(square), occupied) != _sskBishopAttacksRay(square, occupied)) return kFalse;
+		}
+	}
+	
+	return kTrue;
+}
+
+sskBitmap sskBitmapWithRookAttacks(sskChessSquare squareIndex, sskBitmap occupied) {
+	if (squareIndex > 63) return SSK_EMPTY_BITMAP;
+	
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH
+	return _sskRookAttacks(squareIndex, occupied);
+#elif SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_MAGIC
+	return _sskRookAttacksMagic(squareIndex, occupied);
+#else
+	return _sskRookAttacksRay(squareIndex, occupied);
+#endif
+}
+
+sskBitmap sskBitmapWithBishopAttacks(sskChessSquare squareIndex, sskBitmap occupied) {
+	if (squareIndex > 63) return SSK_EMPTY_BITMAP;
+	
+#if SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_DISPATCH
+	return _sskBishopAttacks(squareIndex, occupied);
+#elif SSK_SLIDING_ATTACKS == SSK_SLIDING_ATTACKS_MAGIC
+	return _sskBishopAttacksMagic(squareIndex, occupied);
+#else
+	return _sskBishopAttacksRay(squareIndex, occupied);
+#endif
+}
+
+sskBitmap sskBitmapWithQueenAttacks(sskChessSquare squareIndex, sskBitmap occupied) {
+	return sskBitmapWithRookAttacks(squareIndex, occupied) | sskBitmapWithBishopAttacks(squareIndex, occupied);
+}
+
+#if SSK_SLIDING_ATTACKS != SSK_SLIDING_ATTACKS_RAY
+/**
+ *	Returns the ray starting at fromSquare that passes through toSquare, or an empty bitmap
+ *	if the two squares do not share a rank, file or diagonal.
+ */
+static sskBitmap _sskBitmapWithRayTowards(sskChessSquare fromSquare, sskChessSquare toSquare) {
+	sskBitmap toBitmap = SSK_BITMAP_SET_SQUARE_IDX(toSquare);
+	
+	if (sskBitmapWithEastRank(fromSquare) & toBitmap) return sskBitmapWithEastRank(fromSquare);
+	if (sskBitmapWithWestRank(fromSquare) & toBitmap) return sskBitmapWithWestRank(fromSquare);
+	if (sskBitmapWithNorthFile(fromSquare) & toBitmap) return sskBitmapWithNorthFile(fromSquare);
+	if (sskBitmapWithSouthFile(fromSquare) & toBitmap) return sskBitmapWithSouthFile(fromSquare);
+	if (sskBitmapWithNorthEastDiagonal(fromSquare) & toBitmap) return sskBitmapWithNorthEastDiagonal(fromSquare);
+	if (sskBitmapWithNorthWestDiagonal(fromSquare) & toBitmap) return sskBitmapWithNorthWestDiagonal(fromSquare);
+	if (sskBitmapWithSouthEastDiagonal(fromSquare) & toBitmap) return sskBitmapWithSouthEastDiagonal(fromSquare);
+	if (sskBitmapWithSouthWestDiagonal(fromSquare) & toBitmap) return sskBitmapWithSouthWestDiagonal(fromSquare);
+	
+	return SSK_EMPTY_BITMAP;
+}
+#endif
+
+#pragma mark - Line Functions
+
+sskBitmap sskBitmapWithSquaresBetween(sskChessSquare fromSquare, sskChessSquare toSquare) {
+	if (fromSquare > 63 || toSquare > 63) return SSK_EMPTY_BITMAP;
+	return _sskSquaresBetween[fromSquare][toSquare];
+}
+
+sskBitmap sskBitmapWithLine(sskChessSquare fromSquare, sskChessSquare toSquare) {
+	if (fromSquare > 63 || toSquare > 63) return SSK_EMPTY_BITMAP;
+	return _sskSquaresInLine[fromSquare][toSquare];
+}
+
+sskBitmap sskBitmapWithCastlingEmptySquares(sskChessSquare kingSquare, sskChessSquare kingToSquare, sskChessSquare rookSquare, sskChessSquare rookToSquare) {
+	return (sskBitmapWithCastlingKingPath(kingSquare, kingToSquare) | sskBitmapWithCastlingKingPath(rookSquare, rookToSquare)) &
+		   SSK_BITMAP_UNSET_SQUARE_IDX(kingSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(rookSquare);
+}
+
+sskBitmap sskBitmapWithCastlingKingPath(sskChessSquare kingSquare, sskChessSquare kingToSquare) {
+	return sskBitmapWithSquaresBetween(kingSquare, kingToSquare) | SSK_BITMAP_SET_SQUARE_IDX(kingSquare) | SSK_BITMAP_SET_SQUARE_IDX(kingToSquare);
+}
+
+#pragma mark - Set-wise Attack Functions
+
+static const sskBitmap _sskNotFileA = 0xfefefefefefefefe;
+static const sskBitmap _sskNotFileH = 0x7f7f7f7f7f7f7f7f;
+
+/** Shifts towards h8 for positive and towards a1 for negative amounts. */
+static inline sskBitmap _sskShiftBitmap(sskBitmap bitmap, int shift) {
+	return (shift > 0) ? (bitmap << shift) : (bitmap >> -shift);
+}
+
+/**
+ *	Kogge-Stone occluded fill of the sliders in one direction, followed by one more shift so that
+ *	the first blocker is included. wrapMask drops the squares that wrapped around to the other
+ *	edge of the board(not-A file for eastward directions, not-H file for westward ones).
+ */
+static inline sskBitmap _sskOccludedFillAttacks(sskBitmap sliders, sskBitmap empty, int shift, sskBitmap wrapMask) {
+	sskBitmap propagators = empty & wrapMask;
+	
+	sliders |= propagators & _sskShiftBitmap(sliders, shift);
+	propagators &= _sskShiftBitmap(propagators, shift);
+	sliders |= propagators & _sskShiftBitmap(sliders, 2 * shift);
+	propagators &= _sskShiftBitmap(propagators, 2 * shift);
+	sliders |= propagators & _sskShiftBitmap(sliders, 4 * shift);
+	
+	return _sskShiftBitmap(sliders, shift) & wrapMask;
+}
+
+sskBitmap sskBitmapWithPawnSetAttacks(sskBitmap pawns, sskChessColor pawnColor) {
+	if (pawnColor == sskChessColorWhite) {
+		return ((pawns << 7) & _sskNotFileH) | ((pawns << 9) & _sskNotFileA);
+	}
+	return ((pawns >> 9) & _sskNotFileH) | ((pawns >> 7) & _sskNotFileA);
+}
+
+sskBitmap sskBitmapWithPawnSetPushes(sskBitmap pawns, sskBitmap occupied, sskChessColor pawnColor) {
+	sskBitmap singlePushes;
+	
+	if (pawnColor == sskChessColorWhite) {
+		singlePushes = (pawns << 8) & ~occupied;
+		return singlePushes | (((singlePushes & sskBitmapWithRankMask(2)) << 8) & ~occupied);
+	}
+	
+	singlePushes = (pawns >> 8) & ~occupied;
+	return singlePushes | (((singlePushes & sskBitmapWithRankMask(5)) >> 8) & ~occupied);
+}
+
+sskBitmap sskBitmapWithKnightSetAttacks(sskBitmap knights) {
+	static const sskBitmap notFileAB = 0xfcfcfcfcfcfcfcfc, notFileGH = 0x3f3f3f3f3f3f3f3f;
+	
+	return (((knights << 17) | (knights >> 15)) & _sskNotFileA) |
+		   (((knights << 15) | (knights >> 17)) & _sskNotFileH) |
+		   (((knights << 10) | (knights >> 6)) & notFileAB) |
+		   (((knights << 6) | (knights >> 10)) & notFileGH);
+}
+
+sskBitmap sskBitmapWithKingSetAttacks(sskBitmap kings) {
+	sskBitmap attacks = ((kings << 1) & _sskNotFileA) | ((kings >> 1) & _sskNotFileH);
+	
+	kings |= attacks;
+	return attacks | (kings << 8) | (kings >> 8);
+}
+
+sskBitmap sskBitmapWithRookSetAttacks(sskBitmap sliders, sskBitmap occupied) {
+	sskBitmap empty = ~occupied;
+	
+	return _sskOccludedFillAttacks(sliders, empty, 8, SSK_FULL_BITMAP) |
+		   _sskOccludedFillAttacks(sliders, empty, -8, SSK_FULL_BITMAP) |
+		   _sskOccludedFillAttacks(sliders, empty, 1, _sskNotFileA) |
+		   _sskOccludedFillAttacks(sliders, empty, -1, _sskNotFileH);
+}
+
+sskBitmap sskBitmapWithBishopSetAttacks(sskBitmap sliders, sskBitmap occupied) {
+	sskBitmap empty = ~occupied;
+	
+	return _sskOccludedFillAttacks(sliders, empty, 9, _sskNotFileA) |
+		   _sskOccludedFillAttacks(sliders, empty, 7, _sskNotFileH) |
+		   _sskOccludedFillAttacks(sliders, empty, -7, _sskNotFileA) |
+		   _sskOccludedFillAttacks(sliders, empty, -9, _sskNotFileH);
+}
+
+/**
+ *	Generates the attack kernels of one side. Side is the name suffix and usColor the constant
+ *	color, so the bodies index the side's color bitmap directly and the pawn direction is
+ *	resolved at compile time instead of testing the color on every call.
+ */
+#define _SSK_DEFINE_SIDE_ATTACK_KERNELS(Side, usColor) \
+sskBitmap sskBitmapWithSquaresAttackedBy##Side##InPosition(const sskPosition * position, sskBitmap occupied) { \
+	sskBitmap us = position->colors[(usColor)], queens = sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen) & us; \
+	\
+	return sskBitmapWithPawnSetAttacks(sskBitmapForPieceTypeInPosition(position, sskChessPiecePawn) & us, (usColor)) | \
+		   sskBitmapWithKnightSetAttacks(sskBitmapForPieceTypeInPosition(position, sskChessPieceKnight) & us) | \
+		   sskBitmapWithKingSetAttacks(sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & us) | \
+		   sskBitmapWithRookSetAttacks((sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) & us) | queens, occupied) | \
+		   sskBitmapWithBishopSetAttacks((sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) & us) | queens, occupied); \
+} \
+\
+sskBitmap sskBitmapWith##Side##AttackersToInPosition(const sskPosition * position, sskChessSquare squareIndex, sskBitmap occupied) { \
+	sskBitmap queens = sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen); \
+	\
+	if (squareIndex > 63) return SSK_EMPTY_BITMAP; \
+	\
+	/* A pawn attacks the square if an opponent pawn on the square would attack the pawn. */ \
+	return ((sskBitmapWithPawnSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(squareIndex), !(usColor)) & sskBitmapForPieceTypeInPosition(position, sskChessPiecePawn)) | \
+			(sskBitmapWithKnightReach(squareIndex) & sskBitmapForPieceTypeInPosition(position, sskChessPieceKnight)) | \
+			(sskBitmapWithKingSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(squareIndex)) & sskBitmapForPieceTypeInPosition(position, sskChessPieceKing)) | \
+			(sskBitmapWithRookAttacks(squareIndex, occupied) & (sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) | queens)) | \
+			(sskBitmapWithBishopAttacks(squareIndex, occupied) & (sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) | queens))) & \
+		   position->colors[(usColor)]; \
+}
+
+_SSK_DEFINE_SIDE_ATTACK_KERNELS(White, sskChessColorWhite)
+_SSK_DEFINE_SIDE_ATTACK_KERNELS(Black, sskChessColorBlack)
+
+sskBitmap sskBitmapWithSquaresAttackedBySideInPosition(const sskPosition * position, sskChessColor color, sskBitmap occupied) {
+	return (color == sskChessColorWhite)?sskBitmapWithSquaresAttackedByWhiteInPosition(position, occupied):sskBitmapWithSquaresAttackedByBlackInPosition(position, occupied);
+}
+
+sskBitmap sskBitmapWithSquaresAttackedBySideRef(const sskBitboardPosition * bitboardPosition, sskChessColor color, sskBitmap occupied) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapWithSquaresAttackedBySideInPosition(&position, color, occupied);
+}
+
+sskBitmap sskBitmapWithSquaresAttackedBySide(sskBitboardPosition bitboardPosition, sskChessColor color, sskBitmap occupied) {
+	return sskBitmapWithSquaresAttackedBySideRef(&bitboardPosition, color, occupied);
+}
+
+sskBitmap sskBitmapWithAttackersToInPosition(const sskPosition * position, sskChessSquare squareIndex, sskBitmap occupied) {
+	return sskBitmapWithWhiteAttackersToInPosition(position, squareIndex, occupied) | sskBitmapWithBlackAttackersToInPosition(position, squareIndex, occupied);
+}
+
+sskBitmap sskBitmapWithAttackersToRef(const sskBitboardPosition * bitboardPosition, sskChessSquare squareIndex, sskBitmap occupied) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapWithAttackersToInPosition(&position, squareIndex, occupied);
+}
+
+sskBitmap sskBitmapWithAttackersTo(sskBitboardPosition bitboardPosition, sskChessSquare squareIndex, sskBitmap occupied) {
+	return sskBitmapWithAttackersToRef(&bitboardPosition, squareIndex, occupied);
+}
+
+#pragma mark - Pin Functions
+
+sskBitmap sskBitmapWithPinnedPiecesInPosition(const sskPosition * position, sskChessColor color, sskBitmap * pinners) {
+	sskBitmap king = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & position->colors[color];
+	sskBitmap queens = sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen);
+	sskBitmap occupied = sskBitmapForOccupancyInPosition(position), snipers, blockers, pinned = SSK_EMPTY_BITMAP;
+	sskChessSquare kingSquare, sniperSquare;
+	
+	if (pinners != NULL) *pinners = SSK_EMPTY_BITMAP;
+	if (king == SSK_EMPTY_BITMAP) return SSK_EMPTY_BITMAP;
+	kingSquare = sskFirstOneIndex(king);
+	
+	// Opponent sliders that would attack the king on an empty board.
+	snipers = ((sskBitmapWithRookAttacks(kingSquare, SSK_EMPTY_BITMAP) & (sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) | queens)) |
+			   (sskBitmapWithBishopAttacks(kingSquare, SSK_EMPTY_BITMAP) & (sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) | queens))) &
+			  position->colors[!color];
+	
+	// A sniper pins when exactly one piece, an own one, stands between it and the king.
+	while (snipers) {
+		sniperSquare = sskFirstOneIndex(snipers);
+		snipers &= SSK_BITMAP_UNSET_SQUARE_IDX(sniperSquare);
+		
+		blockers = sskBitmapWithSquaresBetween(kingSquare, sniperSquare) & occupied;
+		if (blockers && !(blockers & (blockers - 1)) && (blockers & position->colors[color])) {
+			pinned |= blockers;
+			if (pinners != NULL) *pinners |= SSK_BITMAP_SET_SQUARE_IDX(sniperSquare);
+		}
+	}
+	
+	return pinned;
+}
+
+sskBitmap sskBitmapWithPinnedPiecesRef(const sskBitboardPosition * bitboardPosition, sskChessColor color, sskBitmap * pinners) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapWithPinnedPiecesInPosition(&position, color, pinners);
+}
+
+sskBitmap sskBitmapWithPinnedPieces(sskBitboardPosition bitboardPosition, sskChessColor color, sskBitmap * pinners) {
+	return sskBitmapWithPinnedPiecesRef(&bitboardPosition, color, pinners);
+}
+
 #pragma mark - Utility Functions
 
-sskBitmap sskBitmapForPieceInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode) {
+sskBitmap sskBitmapForPieceInBitboardPositionRef(const sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode) {
     switch (pieceCode) {
-        case sskChessPieceWPawn: return bitboardPosition.wPawn;
-        case sskChessPieceWKing: return bitboardPosition.wKing;
-        case sskChessPieceWQueen: return bitboardPosition.wQueen;
-        case sskChessPieceWRook: return bitboardPosition.wRook;
-        case sskChessPieceWBishop: return bitboardPosition.wBishop;
-        case sskChessPieceWKnight: return bitboardPosition.wKnight;
-        case sskChessPieceBPawn: return bitboardPosition.bPawn;
-        case sskChessPieceBKing: return bitboardPosition.bKing;
-        case sskChessPieceBQueen: return bitboardPosition.bQueen;
-        case sskChessPieceBRook: return bitboardPosition.bRook;
-        case sskChessPieceBBishop: return bitboardPosition.bBishop;
-        case sskChessPieceBKnight: return bitboardPosition.bKnight;
+        case sskChessPieceWPawn: return bitboardPosition->wPawn;
+        case sskChessPieceWKing: return bitboardPosition->wKing;
+        case sskChessPieceWQueen: return bitboardPosition->wQueen;
+        case sskChessPieceWRook: return bitboardPosition->wRook;
+        case sskChessPieceWBishop: return bitboardPosition->wBishop;
+        case sskChessPieceWKnight: return bitboardPosition->wKnight;
+        case sskChessPieceBPawn: return bitboardPosition->bPawn;
+        case sskChessPieceBKing: return bitboardPosition->bKing;
+        case sskChessPieceBQueen: return bitboardPosition->bQueen;
+        case sskChessPieceBRook: return bitboardPosition->bRook;
+        case sskChessPieceBBishop: return bitboardPosition->bBishop;
+        case sskChessPieceBKnight: return bitboardPosition->bKnight;
     }
     
     return SSK_EMPTY_BITMAP;
 }
 
+sskBitmap sskBitmapForPieceInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode) {
+	return sskBitmapForPieceInBitboardPositionRef(&bitboardPosition, pieceCode);
+}
+
 sskBitmap * sskUpdateableBitmapForPieceInBitboardPosition(sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode) {
 	switch (pieceCode) {
         case sskChessPieceWPawn: return &(bitboardPosition->wPawn);
@@ -386,16 +1091,25 @@ sskBitmap * sskUpdateableBitmapForPieceInBitboardPosition(sskBitboardPosition *
 	return NULL;
 }
 
-sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget) {
-    sskBitmap attacks = SSK_EMPTY_BITMAP, blockers;
+sskBitmap sskBitmapForSpecificPieceAttacksInPosition(const sskPosition * position, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget) {
+    sskBitmap attacks = SSK_EMPTY_BITMAP, blockers, occupied = sskBitmapForOccupancyInPosition(position);
     sskChessSquare blockerSquare;
     sskChessColor color = SSK_GET_PIECE_COLOR(pieceCode);
     
+#if SSK_SLIDING_ATTACKS != SSK_SLIDING_ATTACKS_RAY
+	// Sliders take the whole attack set in one lookup and keep the ray pointing at toSquare.
+	switch (SSK_GET_GENERIC_PIECE_CODE(pieceCode)) {
+		case sskChessPieceQueen: return sskBitmapWithQueenAttacks(fromSquare, occupied) & _sskBitmapWithRayTowards(fromSquare, toSquare);
+		case sskChessPieceRook: return sskBitmapWithRookAttacks(fromSquare, occupied) & _sskBitmapWithRayTowards(fromSquare, toSquare);
+		case sskChessPieceBishop: return sskBitmapWithBishopAttacks(fromSquare, occupied) & _sskBitmapWithRayTowards(fromSquare, toSquare);
+	}
+#endif
+    
     switch (SSK_GET_GENERIC_PIECE_CODE(pieceCode)) {
 		case sskChessPiecePawn: {
 			if (SSK_GET_FILE_IDX(fromSquare) == SSK_GET_FILE_IDX(toSquare)) {
 				attacks = sskBitmapWithPawnReach(fromSquare, color) & sskBitmapWithFileMask(SSK_GET_FILE_IDX(fromSquare));
-				blockers = attacks & bitboardPosition.occupied;
+				blockers = attacks & occupied;
 				if (blockers) {
 					// For white, bitscan from a1, for black bitscan from h8
 					blockerSquare = (color == sskChessColorWhite)?sskFirstOneIndex(blockers):sskLastOneIndex(blockers);
@@ -411,7 +1125,7 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
 			} else {
 				attacks = sskBitmapWithPawnReach(fromSquare, color) & sskBitmapWithFileMask(SSK_GET_FILE_IDX(toSquare));
 				// If white include black pieces else include white pieces into the attack.
-				attacks = attacks & ((color == sskChessColorWhite)?bitboardPosition.bOccupied:bitboardPosition.wOccupied);
+				attacks = attacks & position->colors[!color];
 				
 				// Check for enpassant condition and reset the attacks
 				if (SSK_GET_RANK_IDX(fromSquare) == ((color == sskChessColorWhite)?4:3) &&
@@ -426,13 +1140,17 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
             
 		case sskChessPieceKing: {
 			if (isCastlingOrEnpassantTarget != -1) {
-				short castlingSide = (SSK_GET_FILE_IDX(fromSquare) < isCastlingOrEnpassantTarget)?0:1;
-				attacks = sskBitmapWithKingCastlePath(color, castlingSide, SSK_GET_FILE_IDX(fromSquare), isCastlingOrEnpassantTarget);	// argument acts as rook's file
-				blockers = attacks & bitboardPosition.occupied;
+				// The argument acts as the rook's file, the king lands on the g or c file and the rook next to it.
+				sskChessSquareRank rank = SSK_GET_RANK_IDX(fromSquare);
+				kBool isKingSide = (SSK_GET_FILE_IDX(fromSquare) < isCastlingOrEnpassantTarget) ? kTrue : kFalse;
+				sskChessSquare kingToSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(isKingSide ? 6 : 2, rank);
+				sskChessSquare rookSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(isCastlingOrEnpassantTarget, rank);
+				
+				blockers = sskBitmapWithCastlingEmptySquares(fromSquare, kingToSquare, rookSquare, SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(isKingSide ? 5 : 3, rank)) & occupied;
 				
 				// if any blockers were found.
 				if (blockers != SSK_EMPTY_BITMAP) return SSK_EMPTY_BITMAP;
-				else return attacks;
+				else return sskBitmapWithCastlingKingPath(fromSquare, kingToSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
 				// !IMPORTANT since castling is a special type of move,
 				// we do not follow the normal course of isReachable().
 			} else {
@@ -445,48 +1163,48 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
 			if (SSK_GET_RANK_IDX(fromSquare) == SSK_GET_RANK_IDX(toSquare)) {
 				if (SSK_GET_FILE_IDX(fromSquare) < SSK_GET_FILE_IDX(toSquare)) {	// East
 					attacks = sskBitmapWithEastRank(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithEastRank(blockerSquare);
 				} else if (SSK_GET_FILE_IDX(fromSquare) > SSK_GET_FILE_IDX(toSquare)) {	// West
 					attacks = sskBitmapWithWestRank(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithWestRank(blockerSquare);
 				}
 			} else if (SSK_GET_FILE_IDX(fromSquare) == SSK_GET_FILE_IDX(toSquare)) {
 				if (SSK_GET_RANK_IDX(fromSquare) < SSK_GET_RANK_IDX(toSquare)) {	// North
 					attacks = sskBitmapWithNorthFile(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithNorthFile(blockerSquare);
 				} else if (SSK_GET_RANK_IDX(fromSquare) > SSK_GET_RANK_IDX(toSquare)) {	// South
 					attacks = sskBitmapWithSouthFile(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithSouthFile(blockerSquare);
 				}
 			} else if (SSK_GET_RANK_IDX(fromSquare) < SSK_GET_RANK_IDX(toSquare)) {
 				if (SSK_GET_FILE_IDX(fromSquare) < SSK_GET_FILE_IDX(toSquare)) {	// North East
 					attacks = sskBitmapWithNorthEastDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithNorthEastDiagonal(blockerSquare);
 				} else if (SSK_GET_FILE_IDX(fromSquare) > SSK_GET_FILE_IDX(toSquare)) {	// North West
 					attacks = sskBitmapWithNorthWestDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithNorthWestDiagonal(blockerSquare);
 				}
 			} else if (SSK_GET_RANK_IDX(fromSquare) > SSK_GET_RANK_IDX(toSquare)) {
 				if (SSK_GET_FILE_IDX(fromSquare) < SSK_GET_FILE_IDX(toSquare)) {	// South East
 					attacks = sskBitmapWithSouthEastDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithSouthEastDiagonal(blockerSquare);
 				} else if (SSK_GET_FILE_IDX(fromSquare) > SSK_GET_FILE_IDX(toSquare)) {	// South West
 					attacks = sskBitmapWithSouthWestDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithSouthWestDiagonal(blockerSquare);
 				}
@@ -499,24 +1217,24 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
 			if (SSK_GET_RANK_IDX(fromSquare) == SSK_GET_RANK_IDX(toSquare)) {
 				if (SSK_GET_FILE_IDX(fromSquare) < SSK_GET_FILE_IDX(toSquare)) {	// East
 					attacks = sskBitmapWithEastRank(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithEastRank(blockerSquare);
 				} else if (SSK_GET_FILE_IDX(fromSquare) > SSK_GET_FILE_IDX(toSquare)) {	// West
 					attacks = sskBitmapWithWestRank(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithWestRank(blockerSquare);
 				}
 			} else if (SSK_GET_FILE_IDX(fromSquare) == SSK_GET_FILE_IDX(toSquare)) {
 				if (SSK_GET_RANK_IDX(fromSquare) < SSK_GET_RANK_IDX(toSquare)) {	// North
 					attacks = sskBitmapWithNorthFile(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithNorthFile(blockerSquare);
 				} else if (SSK_GET_RANK_IDX(fromSquare) > SSK_GET_RANK_IDX(toSquare)) {	// South
 					attacks = sskBitmapWithSouthFile(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithSouthFile(blockerSquare);
 				}
@@ -529,24 +1247,24 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
 			if (SSK_GET_RANK_IDX(fromSquare) < SSK_GET_RANK_IDX(toSquare)) {
 				if (SSK_GET_FILE_IDX(fromSquare) < SSK_GET_FILE_IDX(toSquare)) {	// North East
 					attacks = sskBitmapWithNorthEastDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithNorthEastDiagonal(blockerSquare);
 				} else if (SSK_GET_FILE_IDX(fromSquare) > SSK_GET_FILE_IDX(toSquare)) {	// North West
 					attacks = sskBitmapWithNorthWestDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskFirstOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithNorthWestDiagonal(blockerSquare);
 				}
 			} else if (SSK_GET_RANK_IDX(fromSquare) > SSK_GET_RANK_IDX(toSquare)) {
 				if (SSK_GET_FILE_IDX(fromSquare) < SSK_GET_FILE_IDX(toSquare)) {	// South East
 					attacks = sskBitmapWithSouthEastDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithSouthEastDiagonal(blockerSquare);
 				} else if (SSK_GET_FILE_IDX(fromSquare) > SSK_GET_FILE_IDX(toSquare)) {	// South West
 					attacks = sskBitmapWithSouthWestDiagonal(fromSquare);
-					blockers = attacks & bitboardPosition.occupied;
+					blockers = attacks & occupied;
 					blockerSquare = sskLastOneIndex(blockers);
 					attacks = attacks ^ sskBitmapWithSouthWestDiagonal(blockerSquare);
 				}
@@ -564,12 +1282,23 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
     return attacks;
 }
 
-sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare) {
-    sskBitmap pieceBitmap, attacks = SSK_EMPTY_BITMAP, blockers, tempAttacks = SSK_EMPTY_BITMAP;
+sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPositionRef(const sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapForSpecificPieceAttacksInPosition(&position, pieceCode, fromSquare, toSquare, isCastlingOrEnpassantTarget);
+}
+
+sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget) {
+	return sskBitmapForSpecificPieceAttacksInBitboardPositionRef(&bitboardPosition, pieceCode, fromSquare, toSquare, isCastlingOrEnpassantTarget);
+}
+
+sskBitmap sskBitmapForAllPieceAttacksInPosition(const sskPosition * position, sskChessPiece pieceCode, sskChessSquare fromSquare) {
+    sskBitmap pieceBitmap, attacks = SSK_EMPTY_BITMAP, blockers, tempAttacks = SSK_EMPTY_BITMAP, occupied = sskBitmapForOccupancyInPosition(position);
     sskChessSquare curFromSquare, blockerSquare;
     sskChessColor color = SSK_GET_PIECE_COLOR(pieceCode);
     
-    pieceBitmap = sskBitmapForPieceInBitboardPosition(bitboardPosition, pieceCode);
+    if (SSK_GET_GENERIC_PIECE_CODE(pieceCode) == sskChessPieceNone) return SSK_EMPTY_BITMAP;
+    pieceBitmap = sskBitmapForPieceInPosition(position, pieceCode);
     
     while (pieceBitmap) {
         curFromSquare = sskFirstOneIndex(pieceBitmap);
@@ -581,7 +1310,7 @@ sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitb
             case sskChessPiecePawn: {
                 // Same File
                 tempAttacks = sskBitmapWithPawnReach(curFromSquare, color) & sskBitmapWithFileMask(SSK_GET_FILE_IDX(curFromSquare));
-                blockers = tempAttacks & bitboardPosition.occupied;
+                blockers = tempAttacks & occupied;
                 blockerSquare = sskFirstOneIndex(blockers);
                 tempAttacks = tempAttacks ^ (sskBitmapWithPawnReach(blockerSquare, color) & sskBitmapWithFileMask(SSK_GET_FILE_IDX(curFromSquare)));
                 tempAttacks = tempAttacks & SSK_BITMAP_UNSET_SQUARE_IDX(blockerSquare);
@@ -590,7 +1319,7 @@ sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitb
                 
                 // Capture Files (Attack exists only if opponent piece exists
                 tempAttacks = sskBitmapWithPawnReach(curFromSquare, color) & ~sskBitmapWithFileMask(SSK_GET_FILE_IDX(curFromSquare));
-                tempAttacks = tempAttacks & ((color == sskChessColorWhite)?bitboardPosition.bOccupied:bitboardPosition.wOccupied);
+                tempAttacks = tempAttacks & position->colors[!color];
                 
                 attacks |= tempAttacks;
                 
@@ -602,154 +1331,22 @@ sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitb
                 break;
             }
             case sskChessPieceQueen: {
-                
-                // East
-                tempAttacks = sskBitmapWithEastRank(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithEastRank(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // West
-                tempAttacks = sskBitmapWithWestRank(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithWestRank(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                
-                // North
-                
-                tempAttacks = sskBitmapWithNorthFile(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithNorthFile(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // South
-                tempAttacks = sskBitmapWithSouthFile(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithSouthFile(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // North East
-                tempAttacks = sskBitmapWithNorthEastDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithNorthEastDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // North West
-                tempAttacks = sskBitmapWithNorthWestDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithNorthWestDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // South East
-                tempAttacks = sskBitmapWithSouthEastDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithSouthEastDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // South West
-                tempAttacks = sskBitmapWithSouthWestDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithSouthWestDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
+                attacks = sskBitmapWithQueenAttacks(fromSquare, occupied);
                 break;
             }
                 
             case sskChessPieceRook: {
-                // Calculate attacks and blockers in each direction and keep appending to attacks.
-
-                // East
-                tempAttacks = sskBitmapWithEastRank(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithEastRank(blockerSquare);
-                
-                attacks |= tempAttacks;
- 
-                // West
-                tempAttacks = sskBitmapWithWestRank(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithWestRank(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                
-                // North
-
-                tempAttacks = sskBitmapWithNorthFile(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithNorthFile(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // South
-                tempAttacks = sskBitmapWithSouthFile(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithSouthFile(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
+                attacks = sskBitmapWithRookAttacks(fromSquare, occupied);
                 break;
             }
                 
             case sskChessPieceBishop: {
-                // Calculate attacks and blockers in each direction and keep appending to attacks.
-                
-                // North East
-                tempAttacks = sskBitmapWithNorthEastDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithNorthEastDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
-            
-                // North West
-                tempAttacks = sskBitmapWithNorthWestDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskFirstOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithNorthWestDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
-            
-                // South East
-                tempAttacks = sskBitmapWithSouthEastDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithSouthEastDiagonal(blockerSquare);
-                
-                attacks |= tempAttacks;
-                
-                // South West
-                tempAttacks = sskBitmapWithSouthWestDiagonal(fromSquare);
-                blockers = tempAttacks & bitboardPosition.occupied;
-                blockerSquare = sskLastOneIndex(blockers);
-                tempAttacks = tempAttacks ^ sskBitmapWithSouthWestDiagonal(blockerSquare);
-
-                attacks |= tempAttacks;
+                attacks = sskBitmapWithBishopAttacks(fromSquare, occupied);
                 break;
             }
                 
             case sskChessPieceKnight: {
-                attacks = sskBitmapWithKnightReach(curFromSquare) & ~((color == sskChessColorWhite)?bitboardPosition.wOccupied:bitboardPosition.bOccupied);
+                attacks = sskBitmapWithKnightReach(curFromSquare) & ~position->colors[color];
                 break;
             }
         }
@@ -758,17 +1355,28 @@ sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitb
     }
     
     if(SSK_GET_GENERIC_PIECE_CODE(pieceCode) != sskChessPiecePawn && SSK_GET_GENERIC_PIECE_CODE(pieceCode) != sskChessPieceKnight) {
-        attacks = attacks ^ ((color == sskChessColorWhite)?bitboardPosition.wOccupied:bitboardPosition.bOccupied);
+        // Drop the own pieces hit by the attack set(XOR would add the rest of them back in).
+        attacks = attacks & ~position->colors[color];
     }
     return attacks;
 }
 
+sskBitmap sskBitmapForAllPieceAttacksInBitboardPositionRef(const sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapForAllPieceAttacksInPosition(&position, pieceCode, fromSquare);
+}
+
+sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare) {
+	return sskBitmapForAllPieceAttacksInBitboardPositionRef(&bitboardPosition, pieceCode, fromSquare);
+}
+
 sskBitboardPosition * sskxFEN2BitboardPosition(const char * xFENstring) {
 	sskBitboardPosition * pos = NULL;
 	char * ptr = (char *)xFENstring;
 	int i, j;
 	
-	pos = malloc(sizeof(sskBitboardPosition));
+	pos = SSK_MALLOC(sizeof(sskBitboardPosition));
 	
 	// clear the position
 	memset(pos, 0, sizeof(sskBitboardPosition));
@@ -816,32 +1424,88 @@ sskBitboardPosition * sskxFEN2BitboardPosition(const char * xFENstring) {
 	return pos;
 }
 
-sskBitboardPosition * sskCopyBitboardPosition(sskBitboardPosition bitboardPosition) {
-    sskBitboardPosition * copyBitboardPosition = malloc(sizeof(sskBitboardPosition));
-
-    copyBitboardPosition->wPawn = bitboardPosition.wPawn;
-    copyBitboardPosition->wKing = bitboardPosition.wKing;
-    copyBitboardPosition->wQueen = bitboardPosition.wQueen;
-    copyBitboardPosition->wRook = bitboardPosition.wRook;
-    copyBitboardPosition->wBishop = bitboardPosition.wBishop;
-    copyBitboardPosition->wKnight = bitboardPosition.wKnight;
+sskBitboardPosition * sskCopyBitboardPositionRef(const sskBitboardPosition * bitboardPosition) {
+    sskBitboardPosition * copyBitboardPosition = SSK_MALLOC(sizeof(sskBitboardPosition));
+
+    copyBitboardPosition->wPawn = bitboardPosition->wPawn;
+    copyBitboardPosition->wKing = bitboardPosition->wKing;
+    copyBitboardPosition->wQueen = bitboardPosition->wQueen;
+    copyBitboardPosition->wRook = bitboardPosition->wRook;
+    copyBitboardPosition->wBishop = bitboardPosition->wBishop;
+    copyBitboardPosition->wKnight = bitboardPosition->wKnight;
     
-    copyBitboardPosition->bPawn = bitboardPosition.bPawn;
-    copyBitboardPosition->bKing = bitboardPosition.bKing;
-    copyBitboardPosition->bQueen = bitboardPosition.bQueen;
-    copyBitboardPosition->bRook = bitboardPosition.bRook;
-    copyBitboardPosition->bBishop = bitboardPosition.bBishop;
-    copyBitboardPosition->bKnight = bitboardPosition.bKnight;
+    copyBitboardPosition->bPawn = bitboardPosition->bPawn;
+    copyBitboardPosition->bKing = bitboardPosition->bKing;
+    copyBitboardPosition->bQueen = bitboardPosition->bQueen;
+    copyBitboardPosition->bRook = bitboardPosition->bRook;
+    copyBitboardPosition->bBishop = bitboardPosition->bBishop;
+    copyBitboardPosition->bKnight = bitboardPosition->bKnight;
     
-    copyBitboardPosition->wOccupied = bitboardPosition.wOccupied;
-    copyBitboardPosition->bOccupied = bitboardPosition.bOccupied;
-    copyBitboardPosition->occupied = bitboardPosition.occupied;
+    copyBitboardPosition->wOccupied = bitboardPosition->wOccupied;
+    copyBitboardPosition->bOccupied = bitboardPosition->bOccupied;
+    copyBitboardPosition->occupied = bitboardPosition->occupied;
     
 	// Do not replace this function with memcpy(), it takes longer!
 	
     return copyBitboardPosition;
 }
 
+sskBitboardPosition * sskCopyBitboardPosition(sskBitboardPosition bitboardPosition) {
+	return sskCopyBitboardPositionRef(&bitboardPosition);
+}
+
+void sskBitboardPositionToPosition(const sskBitboardPosition * bitboardPosition, sskPosition * position) {
+	position->pieces[sskChessPiecePawn - 1] = bitboardPosition->wPawn | bitboardPosition->bPawn;
+	position->pieces[sskChessPieceKing - 1] = bitboardPosition->wKing | bitboardPosition->bKing;
+	position->pieces[sskChessPieceQueen - 1] = bitboardPosition->wQueen | bitboardPosition->bQueen;
+	position->pieces[sskChessPieceRook - 1] = bitboardPosition->wRook | bitboardPosition->bRook;
+	position->pieces[sskChessPieceBishop - 1] = bitboardPosition->wBishop | bitboardPosition->bBishop;
+	position->pieces[sskChessPieceKnight - 1] = bitboardPosition->wKnight | bitboardPosition->bKnight;
+	
+	// Derived from the piece bitmaps, the occupancy bitmaps of the source may be stale.
+	position->colors[sskChessColorWhite] = bitboardPosition->wPawn | bitboardPosition->wKing | bitboardPosition->wQueen | bitboardPosition->wRook | bitboardPosition->wBishop | bitboardPosition->wKnight;
+	position->colors[sskChessColorBlack] = bitboardPosition->bPawn | bitboardPosition->bKing | bitboardPosition->bQueen | bitboardPosition->bRook | bitboardPosition->bBishop | bitboardPosition->bKnight;
+	
+	sskFillMailboxInPosition(position);
+}
+
+void sskFillMailboxInPosition(sskPosition * position) {
+	sskChessPiece piece;
+	sskBitmap pieceBitmap;
+	sskChessSquare square;
+	
+	memset(position->mailbox, sskChessPieceNone, sizeof(position->mailbox));
+	
+	for (piece = sskChessPiecePawn; piece <= sskChessPieceKnight; piece++) {
+		pieceBitmap = sskBitmapForPieceTypeInPosition(position, piece);
+		while (pieceBitmap) {
+			square = sskFirstOneIndex(pieceBitmap);
+			pieceBitmap = pieceBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(square);
+			position->mailbox[square] = (((position->colors[sskChessColorBlack] & SSK_BITMAP_SET_SQUARE_IDX(square)) ? sskChessColorBlack : sskChessColorWhite) << 3) | piece;
+		}
+	}
+}
+
+void sskPositionToBitboardPosition(const sskPosition * position, sskBitboardPosition * bitboardPosition) {
+	bitboardPosition->wPawn = sskBitmapForPieceInPosition(position, sskChessPieceWPawn);
+	bitboardPosition->wKing = sskBitmapForPieceInPosition(position, sskChessPieceWKing);
+	bitboardPosition->wQueen = sskBitmapForPieceInPosition(position, sskChessPieceWQueen);
+	bitboardPosition->wRook = sskBitmapForPieceInPosition(position, sskChessPieceWRook);
+	bitboardPosition->wBishop = sskBitmapForPieceInPosition(position, sskChessPieceWBishop);
+	bitboardPosition->wKnight = sskBitmapForPieceInPosition(position, sskChessPieceWKnight);
+	
+	bitboardPosition->bPawn = sskBitmapForPieceInPosition(position, sskChessPieceBPawn);
+	bitboardPosition->bKing = sskBitmapForPieceInPosition(position, sskChessPieceBKing);
+	bitboardPosition->bQueen = sskBitmapForPieceInPosition(position, sskChessPieceBQueen);
+	bitboardPosition->bRook = sskBitmapForPieceInPosition(position, sskChessPieceBRook);
+	bitboardPosition->bBishop = sskBitmapForPieceInPosition(position, sskChessPieceBBishop);
+	bitboardPosition->bKnight = sskBitmapForPieceInPosition(position, sskChessPieceBKnight);
+	
+	bitboardPosition->wOccupied = position->colors[sskChessColorWhite];
+	bitboardPosition->bOccupied = position->colors[sskChessColorBlack];
+	bitboardPosition->occupied = sskBitmapForOccupancyInPosition(position);
+}
+
 void sskClearBitboardPosition(sskBitboardPosition * bitboardPosition) {
 	bitboardPosition->wPawn = SSK_EMPTY_BITMAP;
 	bitboardPosition->wKing = SSK_EMPTY_BITMAP;
@@ -878,26 +1542,26 @@ void sskPrintBitmap(sskBitmap bitmap) {
 	}
 }
 
-void sskPrintBitboardPosition(sskBitboardPosition bitboardPosition) {
+void sskPrintBitboardPositionRef(const sskBitboardPosition * bitboardPosition) {
 	char posStr[65];
 	int i, j;
 	
 	for (i = 0; i < 64; i++) posStr[i] = '-';
 	posStr[64] = '\0';
 	
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.wPawn >> i) & 1)?'P':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.wKing >> i) & 1)?'K':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.wQueen >> i) & 1)?'Q':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.wRook >> i) & 1)?'R':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.wBishop >> i) & 1)?'B':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.wKnight >> i) & 1)?'N':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->wPawn >> i) & 1)?'P':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->wKing >> i) & 1)?'K':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->wQueen >> i) & 1)?'Q':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->wRook >> i) & 1)?'R':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->wBishop >> i) & 1)?'B':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->wKnight >> i) & 1)?'N':posStr[i];
 	
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.bPawn >> i) & 1)?'p':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.bKing >> i) & 1)?'k':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.bQueen >> i) & 1)?'q':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.bRook >> i) & 1)?'r':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.bBishop >> i) & 1)?'b':posStr[i];
-	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition.bKnight >> i) & 1)?'n':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->bPawn >> i) & 1)?'p':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->bKing >> i) & 1)?'k':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->bQueen >> i) & 1)?'q':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->bRook >> i) & 1)?'r':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->bBishop >> i) & 1)?'b':posStr[i];
+	for (i = 0; i < 64; i++) posStr[i] = ((bitboardPosition->bKnight >> i) & 1)?'n':posStr[i];
 	
 	printf("\n");
 	for (i = 7; i >= 0; i--) {
@@ -906,4 +1570,68 @@ void sskPrintBitboardPosition(sskBitboardPosition bitboardPosition) {
 		}
 		printf("\n");
 	}
-}
\ No newline at end of file
+}
+
+void sskPrintBitboardPosition(sskBitboardPosition bitboardPosition) {
+	sskPrintBitboardPositionRef(&bitboardPosition);
+}
+
+#pragma mark - Zobrist Hashing Functions
+
+sskZobristKey sskZobristKeyForPieceOnSquare(sskChessPiece piece, sskChessSquare squareIndex) {
+	return _sskZobristPieceKeys[piece & 15][squareIndex & 63];
+}
+
+sskZobristKey sskZobristKeyForPiecesInPosition(const sskPosition * position) {
+	sskZobristKey key = 0;
+	int i;
+	
+	for (i = 0; i < 64; i++) key ^= _sskZobristPieceKeys[position->mailbox[i]][i];
+	
+	return key;
+}
+
+sskZobristKey sskZobristKeyForStateInPosition(const sskPosition * position, sskChessColor sideToMove, const char castlingStatus[5], sskChessSquare enPassantTarget) {
+	sskZobristKey key = (sideToMove == sskChessColorBlack) ? _sskZobristBlackToMoveKey : 0;
+	sskBitmap capturingPawns;
+	int i;
+	
+	for (i = 0; i < 4; i++) {
+		if (castlingStatus[i] != '-' && castlingStatus[i] != '\0') key ^= _sskZobristCastlingKeys[i][SSK_CHAR_2_FILE(tolower(castlingStatus[i])) & 7];
+	}
+	
+	if (enPassantTarget != 0 && enPassantTarget < 64) {
+		capturingPawns = sskBitmapWithPawnSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(enPassantTarget), !sideToMove) & sskBitmapForPieceInPosition(position, (sideToMove << 3) | sskChessPiecePawn);
+		if (capturingPawns) key ^= _sskZobristEnPassantKeys[SSK_GET_FILE_IDX(enPassantTarget)];
+	}
+	
+	return key;
+}
+
+sskZobristKey sskZobristKeyForPosition(const sskPosition * position, sskChessColor sideToMove, const char castlingStatus[5], sskChessSquare enPassantTarget) {
+	return sskZobristKeyForPiecesInPosition(position) ^ sskZobristKeyForStateInPosition(position, sideToMove, castlingStatus, enPassantTarget);
+}
+
+#pragma mark - Material Functions
+
+sskMaterialKey sskMaterialKeyForPosition(const sskPosition * position) {
+	sskMaterialKey materialKey = 0;
+	sskChessColor color;
+	sskBitmap bishops;
+	
+	for (color = sskChessColorWhite; color <= sskChessColorBlack; color++) {
+		bishops = sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) & position->colors[color];
+		materialKey |= ((sskMaterialKey)sskCountBits(sskBitmapForPieceTypeInPosition(position, sskChessPiecePawn) & position->colors[color]) << (color * 24 + sskMaterialSlotPawn * 4)) |
+					   ((sskMaterialKey)sskCountBits(sskBitmapForPieceTypeInPosition(position, sskChessPieceKnight) & position->colors[color]) << (color * 24 + sskMaterialSlotKnight * 4)) |
+					   ((sskMaterialKey)sskCountBits(bishops & SSK_LIGHT_SQUARES_BITMAP) << (color * 24 + sskMaterialSlotLightBishop * 4)) |
+					   ((sskMaterialKey)sskCountBits(bishops & ~SSK_LIGHT_SQUARES_BITMAP) << (color * 24 + sskMaterialSlotDarkBishop * 4)) |
+					   ((sskMaterialKey)sskCountBits(sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) & position->colors[color]) << (color * 24 + sskMaterialSlotRook * 4)) |
+					   ((sskMaterialKey)sskCountBits(sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen) & position->colors[color]) << (color * 24 + sskMaterialSlotQueen * 4));
+	}
+	
+	return materialKey;
+}
+
+sskMaterialClass sskMaterialClassForKey(sskMaterialKey materialKey) {
+	return _sskMaterialClasses[_sskMaterialSideIndex(materialKey, sskChessColorWhite) * 192 + _sskMaterialSideIndex(materialKey, sskChessColorBlack)];
+}
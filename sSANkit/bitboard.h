@@ -13,8 +13,37 @@
 #include "ChessSquare.h"
 #include "chesscolor.h"
 #include "chesspiece.h"
+#include "bool.h"
+
+#include <stdint.h>
 
 typedef unsigned long long sskBitmap;	/** 64-bit bitmap, mapping to chess squares(LSB=a1 and MSB=h8). */
+typedef unsigned long long sskZobristKey;	/** 64-bit Zobrist hash identifying a position. */
+typedef unsigned long long sskMaterialKey;	/** Piece counts of a position packed in 4-bit fields, see sskMaterialKeyForPosition(). */
+
+/**
+ *	Backends for computing rook, bishop and queen attacks. SSK_SLIDING_ATTACKS_RAY scans
+ *	one direction at a time with the ray lookups and a bitscan per ray. SSK_SLIDING_ATTACKS_MAGIC
+ *	uses magic bitboards, so that the attack set of a slider costs one multiply, one shift and
+ *	one table load. SSK_SLIDING_ATTACKS_DISPATCH picks the backend at startup: BMI2 PEXT indexing
+ *	when the CPU supports it, magic bitboards otherwise, and it can be switched at runtime with
+ *	sskSetSlidingAttacksBackend(). Define SSK_SLIDING_ATTACKS in the build settings to select.
+ */
+#define SSK_SLIDING_ATTACKS_RAY			(0)
+#define SSK_SLIDING_ATTACKS_MAGIC		(1)
+#define SSK_SLIDING_ATTACKS_DISPATCH	(2)
+
+#ifndef SSK_SLIDING_ATTACKS
+#define SSK_SLIDING_ATTACKS SSK_SLIDING_ATTACKS_DISPATCH
+#endif
+
+/** Sliding attack backends, as reported by sskCurrentSlidingAttacksBackend(). */
+enum {
+	sskSlidingAttacksBackendRay		= 0,	/** Ray lookups with a bitscan per direction */
+	sskSlidingAttacksBackendMagic	= 1,	/** Magic bitboards, portable */
+	sskSlidingAttacksBackendPext	= 2		/** BMI2 PEXT indexed tables, x86-64 only */
+};
+typedef unsigned short sskSlidingAttacksBackend;	/** Custom type for the sliding attack backends */
 
 /** Convenience macro for setting something to an empty bitmap */
 #define SSK_EMPTY_BITMAP ((sskBitmap)(0))
@@ -48,6 +77,34 @@ typedef struct _sskBitboardPosition {
 	
 } sskBitboardPosition;
 
+/**
+ *	A position is fifteen bitmaps(120 bytes). Every function taking one has a "Ref" variant
+ *	that takes it by const pointer instead. The by-value functions remain as wrappers for
+ *	existing callers. Internally the library works on the compact sskPosition below, the
+ *	"Ref" variants convert to it and call the "InPosition" functions.
+ */
+
+/** Aligns a type to a 64 byte cache line, where the compiler supports it. */
+#if defined(__GNUC__)
+#define SSK_CACHE_ALIGNED __attribute__((aligned(64)))
+#else
+#define SSK_CACHE_ALIGNED
+#endif
+
+/**
+ *	Compact position of eight bitmaps: one per generic piece type holding both colors, and one
+ *	per color holding all of its pieces. The bitmap of a colored piece is the AND of its type and
+ *	color bitmaps, two indexed loads instead of a switch over the twelve piece codes. The bitmaps
+ *	fill the first 64 byte cache line, the second holds a mailbox with the piece code of every
+ *	square, kept in sync so that piece-on-square lookups are one byte read. Use the accessors
+ *	below rather than the arrays directly.
+ */
+typedef struct SSK_CACHE_ALIGNED _sskPosition {
+	sskBitmap pieces[6];	/** bitmaps of the pieces by type, indexed by generic piece code - 1. */
+	sskBitmap colors[2];	/** bitmaps of the pieces by color, indexed by sskChessColor. */
+	uint8_t mailbox[64];	/** 4-bit piece code on each square(a1-h8), sskChessPieceNone if empty. */
+} sskPosition;
+
 /** Returns a bitmap with 1 at the bit corresponding to the square index (0-63) and the other bits to 0 */
 #define SSK_BITMAP_SET_SQUARE_IDX(squareIndex) ((sskBitmap)0x8000000000000000 >> (63 - (squareIndex)))
 
@@ -215,6 +272,62 @@ sskBitmap sskBitmapWithWestRank(sskChessSquare squareIndex);
 
 #pragma mark - BitScan Functions
 
+/**
+ *	The bit scans and the popcount are defined inline below so that callers in every translation
+ *	unit get the single instruction versions. With GCC or Clang they use the compiler builtins
+ *	(tzcnt/bsf, lzcnt/bsr and popcnt where available), other compilers get the portable table
+ *	based versions. Define SSK_PORTABLE_BITSCAN in the build settings to force the portable ones.
+ */
+#if !defined(SSK_PORTABLE_BITSCAN) && defined(__GNUC__)
+#define SSK_BITSCAN_BUILTINS (1)
+#else
+#define SSK_BITSCAN_BUILTINS (0)
+#endif
+
+/**
+ *	POPCNT is not part of the x86-64 baseline, so unless the build targets it(-mpopcnt, -march=...)
+ *	the instruction is selected at runtime. sskInitBitboards() sets the flag from CPUID.
+ */
+#if SSK_BITSCAN_BUILTINS && defined(__x86_64__) && !defined(__POPCNT__)
+#define SSK_RUNTIME_POPCNT (1)
+extern kBool sskCPUHasPopcount;	/** kTrue if the CPU executing the code supports POPCNT */
+#else
+#define SSK_RUNTIME_POPCNT (0)
+#endif
+
+/**
+ *	Portable version of sskCountBits(), SWAR popcount(MIT HAKMEM).
+ *
+ *	@param bitmap The bitmap in which the number of bits is to be counted.
+ *
+ *	@return The number of bits set to 1.
+ */
+unsigned short sskCountBitsPortable(sskBitmap bitmap);
+
+/**
+ *	Portable version of sskFirstOneIndex(), De Bruijn multiplication.
+ *
+ *	@param bitmap The bitmap in which the first set bit is to be found.
+ *
+ *	@return The index of the first bit set to 1, starting from LSB(0-63). Returns 63 when 0 is passed.
+ */
+unsigned short sskFirstOneIndexPortable(sskBitmap bitmap);
+
+/**
+ *	Portable version of sskLastOneIndex(), Eugene Nalimov's bitScanReverse.
+ *
+ *	@param bitmap The bitmap in which the last set bit is to be found.
+ *
+ *	@return The index of the last bit set to 1, starting from LSB(0-63). Returns 0 when 0 is passed.
+ */
+unsigned short sskLastOneIndexPortable(sskBitmap bitmap);
+
+#if SSK_RUNTIME_POPCNT
+__attribute__((target("popcnt"))) static inline unsigned short _sskCountBitsPopcnt(sskBitmap bitmap) {
+	return (unsigned short)__builtin_popcountll(bitmap);
+}
+#endif
+
 /**
  *	Utility function to count the number of bits set to 1 in a bitmap.
  *
@@ -222,31 +335,334 @@ sskBitmap sskBitmapWithWestRank(sskChessSquare squareIndex);
  *
  *	@return The number of bits set to 1.
  */
-unsigned short sskCountBits(sskBitmap bitmap);
+static inline unsigned short sskCountBits(sskBitmap bitmap) {
+#if SSK_RUNTIME_POPCNT
+	return sskCPUHasPopcount ? _sskCountBitsPopcnt(bitmap) : sskCountBitsPortable(bitmap);
+#elif SSK_BITSCAN_BUILTINS
+	return (unsigned short)__builtin_popcountll(bitmap);
+#else
+	return sskCountBitsPortable(bitmap);
+#endif
+}
 
 /**
  *	Utility function to obtain the index of the first bit in
  *	the given bitmap with value 1, starting from the LSB.
- *	Do not pass 0 to this function!
+ *	The sliding attack ray scans rely on the value returned for 0.
  *
  *	@param bitmap The bitmap in which the first set bit is to be found.
  *
  *	@return The index of the first bit set to 1, starting from LSB(0-63).
- *			Unpredictable values will be returned when 0 is passed.
+ *			Returns 63 when 0 is passed.
  */
-unsigned short sskFirstOneIndex(sskBitmap bitmap);
+static inline unsigned short sskFirstOneIndex(sskBitmap bitmap) {
+#if SSK_BITSCAN_BUILTINS
+	// Setting the MSB makes 0 return 63 and keeps the builtin defined.
+	return (unsigned short)__builtin_ctzll(bitmap | 0x8000000000000000);
+#else
+	return sskFirstOneIndexPortable(bitmap);
+#endif
+}
 
 /**
  *	Utility function to obtain the index of the last bit in
  *	the given bitmap with value 1, starting from the LSB.
- *	Do not pass 0 to this fuction!
+ *	The sliding attack ray scans rely on the value returned for 0.
  *
  *	@param bitmap The bitmap in which the last set bit is to be found.
  *
  *	@return The index of the last bit set to 1, starting from LSB(0-63).
- *			Unpredictable values will be returned when 0 is passed.
+ *			Returns 0 when 0 is passed.
+ */
+static inline unsigned short sskLastOneIndex(sskBitmap bitmap) {
+#if SSK_BITSCAN_BUILTINS
+	// Setting the LSB makes 0 return 0 and keeps the builtin defined.
+	return (unsigned short)(63 ^ __builtin_clzll(bitmap | 1));
+#else
+	return sskLastOneIndexPortable(bitmap);
+#endif
+}
+
+#pragma mark - Sliding Attack Functions
+
+/**
+ *	Function initializes the lookup tables used by the sliding attack functions. The magic
+ *	tables are filled from the ray lookups and every entry is checked for destructive
+ *	collisions on the way. The between and line tables, the Zobrist keys and the material
+ *	classification table are built here too. The CPU features used by the bit scans and the backends are probed
+ *	here as well. It is safe to call this function more than once, later calls return
+ *	the result of the first one. On GCC/Clang builds it runs automatically at load time,
+ *	the analyzer's entry points still call it so that compilers without load time
+ *	constructors get the tables built before their first use.
+ *
+ *	@return kTrue if the tables were built and verified, kFalse if a magic number is broken.
+ */
+kBool sskInitBitboards(void);
+
+/**
+ *	Function verifies the selected sliding attack backend and the set-wise slider fills against
+ *	the ray lookups for every square, using random occupancies (including bits outside the relevant masks).
+ *
+ *	@param samplesPerSquare The number of random occupancies to try on each square.
+ *
+ *	@return kTrue if both rook and bishop attacks agree with the ray lookups, else kFalse.
+ */
+kBool sskVerifySlidingAttacks(unsigned int samplesPerSquare);
+
+/**
+ *	Function returns the backend currently used by the sliding attack functions.
+ *
+ *	@return The backend in use.
+ */
+sskSlidingAttacksBackend sskCurrentSlidingAttacksBackend(void);
+
+/**
+ *	Function switches the backend used by the sliding attack functions. Only builds with
+ *	SSK_SLIDING_ATTACKS_DISPATCH can switch, the others are fixed at compile time. This is
+ *	meant for benchmarking, do not call it while other threads are computing attacks.
+ *
+ *	@param backend The backend to use.
+ *
+ *	@return kTrue if the backend is now in use, kFalse if it is not available on this build or CPU.
+ */
+kBool sskSetSlidingAttacksBackend(sskSlidingAttacksBackend backend);
+
+/**
+ *	Function returns the squares attacked by a rook on the given square. Blockers are
+ *	included in the attack set irrespective of their color.
+ *
+ *	@param squareIndex The square number(0-63).
+ *	@param occupied The bitmap of all occupied squares.
+ *
+ *	@return A bitmap with the squares attacked by a rook. Empty bitmap on invalid square index.
+ */
+sskBitmap sskBitmapWithRookAttacks(sskChessSquare squareIndex, sskBitmap occupied);
+
+/**
+ *	Function returns the squares attacked by a bishop on the given square. Blockers are
+ *	included in the attack set irrespective of their color.
+ *
+ *	@param squareIndex The square number(0-63).
+ *	@param occupied The bitmap of all occupied squares.
+ *
+ *	@return A bitmap with the squares attacked by a bishop. Empty bitmap on invalid square index.
+ */
+sskBitmap sskBitmapWithBishopAttacks(sskChessSquare squareIndex, sskBitmap occupied);
+
+/**
+ *	Function returns the squares attacked by a queen on the given square, the union of
+ *	sskBitmapWithRookAttacks() and sskBitmapWithBishopAttacks().
+ *
+ *	@param squareIndex The square number(0-63).
+ *	@param occupied The bitmap of all occupied squares.
+ *
+ *	@return A bitmap with the squares attacked by a queen. Empty bitmap on invalid square index.
+ */
+sskBitmap sskBitmapWithQueenAttacks(sskChessSquare squareIndex, sskBitmap occupied);
+
+#pragma mark - Line Functions
+
+/**
+ *	Function returns the squares strictly between two squares that share a rank, file or
+ *	diagonal. The table is built by sskInitBitboards().
+ *
+ *	@param fromSquare The first square(0-63).
+ *	@param toSquare The second square(0-63).
+ *
+ *	@return A bitmap with the squares between fromSquare and toSquare, excluding both.
+ *			Returns an empty bitmap if the squares are not aligned, adjacent or invalid.
+ */
+sskBitmap sskBitmapWithSquaresBetween(sskChessSquare fromSquare, sskChessSquare toSquare);
+
+/**
+ *	Function returns the whole rank, file or diagonal passing through two squares, from board
+ *	edge to board edge. The table is built by sskInitBitboards().
+ *
+ *	@param fromSquare The first square(0-63).
+ *	@param toSquare The second square(0-63).
+ *
+ *	@return A bitmap with the line through both squares, including them.
+ *			Returns an empty bitmap if the squares are not aligned, equal or invalid.
+ */
+sskBitmap sskBitmapWithLine(sskChessSquare fromSquare, sskChessSquare toSquare);
+
+/**
+ *	Function returns the squares that have to be empty for castling: both paths with their
+ *	destinations, except the squares of the castling king and rook. Works for any Chess960
+ *	king and rook files, the squares must be on one rank.
+ *
+ *	@param kingSquare The square of the castling king.
+ *	@param kingToSquare The king's destination, g or c file.
+ *	@param rookSquare The square of the castling rook.
+ *	@param rookToSquare The rook's destination, f or d file.
+ *
+ *	@return A bitmap of the squares to be empty.
+ */
+sskBitmap sskBitmapWithCastlingEmptySquares(sskChessSquare kingSquare, sskChessSquare kingToSquare, sskChessSquare rookSquare, sskChessSquare rookToSquare);
+
+/**
+ *	Function returns the squares the castling king stands on or passes, from its square to its
+ *	destination both included. None of them may be attacked by the opponent.
+ *
+ *	@param kingSquare The square of the castling king.
+ *	@param kingToSquare The king's destination, g or c file.
+ *
+ *	@return A bitmap of the king's castling path.
+ */
+sskBitmap sskBitmapWithCastlingKingPath(sskChessSquare kingSquare, sskChessSquare kingToSquare);
+
+#pragma mark - Set-wise Attack Functions
+
+/**
+ *	Function returns the squares attacked by all the pawns in the given bitmap, computed by
+ *	shifting the whole set at once.
+ *
+ *	@param pawns The bitmap of the pawns.
+ *	@param pawnColor The color of the pawns.
+ *
+ *	@return A bitmap with the squares attacked by the pawns.
+ */
+sskBitmap sskBitmapWithPawnSetAttacks(sskBitmap pawns, sskChessColor pawnColor);
+
+/**
+ *	Function returns the squares all the pawns in the given bitmap can push to, including
+ *	the double push from the starting rank.
+ *
+ *	@param pawns The bitmap of the pawns.
+ *	@param occupied The bitmap of all occupied squares.
+ *	@param pawnColor The color of the pawns.
+ *
+ *	@return A bitmap with the empty squares the pawns can advance to.
+ */
+sskBitmap sskBitmapWithPawnSetPushes(sskBitmap pawns, sskBitmap occupied, sskChessColor pawnColor);
+
+/**
+ *	Function returns the squares attacked by all the knights in the given bitmap.
+ *
+ *	@param knights The bitmap of the knights.
+ *
+ *	@return A bitmap with the squares attacked by the knights.
  */
-unsigned short sskLastOneIndex(sskBitmap bitmap);
+sskBitmap sskBitmapWithKnightSetAttacks(sskBitmap knights);
+
+/**
+ *	Function returns the squares attacked by all the kings in the given bitmap.
+ *
+ *	@param kings The bitmap of the kings.
+ *
+ *	@return A bitmap with the squares attacked by the kings.
+ */
+sskBitmap sskBitmapWithKingSetAttacks(sskBitmap kings);
+
+/**
+ *	Function returns the squares attacked along ranks and files by all the sliders in the
+ *	given bitmap, using Kogge-Stone occluded fills. Blockers are included irrespective of color.
+ *
+ *	@param sliders The bitmap of the rooks(and queens).
+ *	@param occupied The bitmap of all occupied squares.
+ *
+ *	@return A bitmap with the squares attacked by the sliders.
+ */
+sskBitmap sskBitmapWithRookSetAttacks(sskBitmap sliders, sskBitmap occupied);
+
+/**
+ *	Function returns the squares attacked along diagonals by all the sliders in the
+ *	given bitmap, using Kogge-Stone occluded fills. Blockers are included irrespective of color.
+ *
+ *	@param sliders The bitmap of the bishops(and queens).
+ *	@param occupied The bitmap of all occupied squares.
+ *
+ *	@return A bitmap with the squares attacked by the sliders.
+ */
+sskBitmap sskBitmapWithBishopSetAttacks(sskBitmap sliders, sskBitmap occupied);
+
+/**
+ *	Function returns all the squares attacked by the pieces of one side, including squares
+ *	occupied by its own pieces(defended squares). Sliders see through the squares missing
+ *	from the given occupancy, so pass the occupancy without the enemy king to find the
+ *	squares that king can not step to.
+ *
+ *	@param bitboardPosition The position in bitboard format.
+ *	@param color The side whose attacks are computed.
+ *	@param occupied The occupancy used to block the sliders, normally bitboardPosition.occupied.
+ *
+ *	@return A bitmap with the squares attacked by the given side.
+ */
+sskBitmap sskBitmapWithSquaresAttackedBySide(sskBitboardPosition bitboardPosition, sskChessColor color, sskBitmap occupied);
+
+/** Const pointer variant of sskBitmapWithSquaresAttackedBySide(). */
+sskBitmap sskBitmapWithSquaresAttackedBySideRef(const sskBitboardPosition * bitboardPosition, sskChessColor color, sskBitmap occupied);
+
+/** Compact position variant of sskBitmapWithSquaresAttackedBySide(). */
+sskBitmap sskBitmapWithSquaresAttackedBySideInPosition(const sskPosition * position, sskChessColor color, sskBitmap occupied);
+
+/**
+ *	Function returns every piece of either color that attacks the given square, found by
+ *	looking from the square outwards: knight reach from the square intersected with the
+ *	knights, rook attacks from the square with the rooks and queens, and so on. A piece
+ *	standing on the square itself is not included. Mask the result with wOccupied or
+ *	bOccupied to get the attackers of one side.
+ *
+ *	@param bitboardPosition The position in bitboard format.
+ *	@param squareIndex The attacked square(0-63).
+ *	@param occupied The occupancy used to block the sliders, normally bitboardPosition.occupied.
+ *
+ *	@return A bitmap with the squares of the attacking pieces. Empty bitmap on invalid square index.
+ */
+sskBitmap sskBitmapWithAttackersTo(sskBitboardPosition bitboardPosition, sskChessSquare squareIndex, sskBitmap occupied);
+
+/** Const pointer variant of sskBitmapWithAttackersTo(). */
+sskBitmap sskBitmapWithAttackersToRef(const sskBitboardPosition * bitboardPosition, sskChessSquare squareIndex, sskBitmap occupied);
+
+/** Compact position variant of sskBitmapWithAttackersTo(). */
+sskBitmap sskBitmapWithAttackersToInPosition(const sskPosition * position, sskChessSquare squareIndex, sskBitmap occupied);
+
+/**
+ *	Per side specializations of sskBitmapWithSquaresAttackedBySideInPosition() and of
+ *	sskBitmapWithAttackersToInPosition() restricted to one side's pieces. They are generated by a
+ *	macro in bitboard.c, so the side is fixed at compile time and the bodies have no color tests.
+ */
+sskBitmap sskBitmapWithSquaresAttackedByWhiteInPosition(const sskPosition * position, sskBitmap occupied);
+sskBitmap sskBitmapWithSquaresAttackedByBlackInPosition(const sskPosition * position, sskBitmap occupied);
+sskBitmap sskBitmapWithWhiteAttackersToInPosition(const sskPosition * position, sskChessSquare squareIndex, sskBitmap occupied);
+sskBitmap sskBitmapWithBlackAttackersToInPosition(const sskPosition * position, sskChessSquare squareIndex, sskBitmap occupied);
+
+#pragma mark - Pin Functions
+
+/**
+ *	Function returns the absolutely pinned pieces of a side, the own pieces that are the only
+ *	piece between their king and an opponent slider on the same rank, file or diagonal. The
+ *	sliders are found by x-raying from the king over an empty board, so the whole set is built
+ *	with one pass over the few sliders aligned with the king.
+ *
+ *	@param bitboardPosition The position in bitboard format.
+ *	@param color The side whose pinned pieces are computed.
+ *	@param pinners If not NULL, receives the opponent sliders causing the pins.
+ *
+ *	@return A bitmap with the pinned pieces of the given side. Empty bitmap if the side has no king.
+ */
+sskBitmap sskBitmapWithPinnedPieces(sskBitboardPosition bitboardPosition, sskChessColor color, sskBitmap * pinners);
+
+/** Const pointer variant of sskBitmapWithPinnedPieces(). */
+sskBitmap sskBitmapWithPinnedPiecesRef(const sskBitboardPosition * bitboardPosition, sskChessColor color, sskBitmap * pinners);
+
+/** Compact position variant of sskBitmapWithPinnedPieces(). */
+sskBitmap sskBitmapWithPinnedPiecesInPosition(const sskPosition * position, sskChessColor color, sskBitmap * pinners);
+
+/**
+ *	Function returns the squares a piece may move to as far as pins are concerned: the line
+ *	through its king when the piece is pinned, which keeps it between the king and the pinner or
+ *	captures the pinner, and every square otherwise. A pin test is then a single AND.
+ *
+ *	@param pinnedPieces The pinned pieces of the side, from sskBitmapWithPinnedPiecesInPosition().
+ *	@param kingSquare The square of the side's king.
+ *	@param squareIndex The square of the piece to move.
+ *
+ *	@return A bitmap with the squares allowed by pins.
+ */
+static inline sskBitmap sskBitmapWithPinAllowedSquares(sskBitmap pinnedPieces, sskChessSquare kingSquare, sskChessSquare squareIndex) {
+	return (pinnedPieces & SSK_BITMAP_SET_SQUARE_IDX(squareIndex)) ? sskBitmapWithLine(kingSquare, squareIndex) : SSK_FULL_BITMAP;
+}
 
 #pragma mark - Utility Functions
 /**
@@ -260,6 +676,41 @@ unsigned short sskLastOneIndex(sskBitmap bitmap);
  */
 sskBitmap sskBitmapForPieceInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode);
 
+/** Const pointer variant of sskBitmapForPieceInBitboardPosition(). */
+sskBitmap sskBitmapForPieceInBitboardPositionRef(const sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode);
+
+/**
+ *	Function returns the bitmap of the given colored piece in a compact position.
+ *
+ *	@param position The position in compact format.
+ *	@param pieceCode The 4-bit piece code, must not be sskChessPieceNone.
+ *
+ *	@return The bitmap for the given piece code.
+ */
+static inline sskBitmap sskBitmapForPieceInPosition(const sskPosition * position, sskChessPiece pieceCode) {
+	return position->pieces[SSK_GET_GENERIC_PIECE_CODE(pieceCode) - 1] & position->colors[SSK_GET_PIECE_COLOR(pieceCode)];
+}
+
+/** Returns the bitmap of a generic piece type(sskChessPiecePawn...) of both colors in a compact position. */
+static inline sskBitmap sskBitmapForPieceTypeInPosition(const sskPosition * position, sskChessPiece genericPieceCode) {
+	return position->pieces[genericPieceCode - 1];
+}
+
+/** Returns the bitmap of all the pieces of one color in a compact position. */
+static inline sskBitmap sskBitmapForColorInPosition(const sskPosition * position, sskChessColor color) {
+	return position->colors[color];
+}
+
+/** Returns the bitmap of all occupied squares in a compact position. */
+static inline sskBitmap sskBitmapForOccupancyInPosition(const sskPosition * position) {
+	return position->colors[sskChessColorWhite] | position->colors[sskChessColorBlack];
+}
+
+/** Returns the 4-bit code of the piece on a square(0-63) of a compact position, sskChessPieceNone if empty. */
+static inline sskChessPiece sskPieceOnSquareInPosition(const sskPosition * position, sskChessSquare squareIndex) {
+	return position->mailbox[squareIndex];
+}
+
 /**
  *	Function returns a pointer to the bitmap in the given bitboard position. This function
  *	is the same as sskBitmapForPieceInBitboardPosition() except that the bitmap can be updated.
@@ -286,6 +737,12 @@ sskBitmap * sskUpdateableBitmapForPieceInBitboardPosition(sskBitboardPosition *
  */
 sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget);
 
+/** Const pointer variant of sskBitmapForSpecificPieceAttacksInBitboardPosition(). */
+sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPositionRef(const sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget);
+
+/** Compact position variant of sskBitmapForSpecificPieceAttacksInBitboardPosition(). */
+sskBitmap sskBitmapForSpecificPieceAttacksInPosition(const sskPosition * position, sskChessPiece pieceCode, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget);
+
 /**
  *  Function returns the attack bitmap with all reachable squares of the given piece in the given bitboard position.
  *  NOTE: - This function does not consider castling, enpassant moves or pins. Function considers blockers.
@@ -299,6 +756,12 @@ sskBitmap sskBitmapForSpecificPieceAttacksInBitboardPosition(sskBitboardPosition
  */
 sskBitmap sskBitmapForAllPieceAttacksInBitboardPosition(sskBitboardPosition bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare);
 
+/** Const pointer variant of sskBitmapForAllPieceAttacksInBitboardPosition(). */
+sskBitmap sskBitmapForAllPieceAttacksInBitboardPositionRef(const sskBitboardPosition * bitboardPosition, sskChessPiece pieceCode, sskChessSquare fromSquare);
+
+/** Compact position variant of sskBitmapForAllPieceAttacksInBitboardPosition(). */
+sskBitmap sskBitmapForAllPieceAttacksInPosition(const sskPosition * position, sskChessPiece pieceCode, sskChessSquare fromSquare);
+
 /**
  *	Utilty function to extract the piece placement information from the given
  *	xFEN string and convert it to a Bitboard position.
@@ -321,6 +784,34 @@ sskBitboardPosition * sskxFEN2BitboardPosition(const char * xFENstring);
  */
 sskBitboardPosition * sskCopyBitboardPosition(sskBitboardPosition bitboardPosition);
 
+/** Const pointer variant of sskCopyBitboardPosition(). */
+sskBitboardPosition * sskCopyBitboardPositionRef(const sskBitboardPosition * bitboardPosition);
+
+/**
+ *	Utility function to convert a bitboard position to the compact format.
+ *
+ *	@param bitboardPosition The position in bitboard format.
+ *	@param position Out param, filled with the position in compact format.
+ */
+void sskBitboardPositionToPosition(const sskBitboardPosition * bitboardPosition, sskPosition * position);
+
+/**
+ *	Utility function to rebuild the mailbox of a compact position from its bitmaps. Only needed
+ *	after editing the bitmaps directly, the conversion and move functions keep it in sync.
+ *
+ *	@param position The position whose mailbox is refilled.
+ */
+void sskFillMailboxInPosition(sskPosition * position);
+
+/**
+ *	Utility function to convert a compact position to the bitboard format, including the
+ *	occupancy bitmaps.
+ *
+ *	@param position The position in compact format.
+ *	@param bitboardPosition Out param, filled with the position in bitboard format.
+ */
+void sskPositionToBitboardPosition(const sskPosition * position, sskBitboardPosition * bitboardPosition);
+
 /**
  *	Utility function to clear all the bitmaps in the given bitboard.
  *
@@ -342,4 +833,149 @@ void sskPrintBitmap(sskBitmap bitmap);
  */
 void sskPrintBitboardPosition(sskBitboardPosition bitboardPosition);
 
+/** Const pointer variant of sskPrintBitboardPosition(). */
+void sskPrintBitboardPositionRef(const sskBitboardPosition * bitboardPosition);
+
+#pragma mark - Zobrist Hashing Functions
+
+/**
+ *	Function returns the Zobrist key of a piece standing on a square. The keys come from a
+ *	fixed seed, so a position hashes to the same value on every build and every run and keys
+ *	can be stored. The table is built by sskInitBitboards().
+ *
+ *	@param piece The 4-bit piece code, sskChessPieceNone has the key 0.
+ *	@param squareIndex The square index(0-63).
+ *
+ *	@return The key to XOR in or out of a position key.
+ */
+sskZobristKey sskZobristKeyForPieceOnSquare(sskChessPiece piece, sskChessSquare squareIndex);
+
+/**
+ *	Function computes the part of a position key contributed by the pieces, from scratch.
+ *	Keep it up to date across moves by XORing the keys of the squares that change.
+ *
+ *	@param position The position in compact format.
+ *
+ *	@return The XOR of the keys of all pieces on their squares.
+ */
+sskZobristKey sskZobristKeyForPiecesInPosition(const sskPosition * position);
+
+/**
+ *	Function computes the part of a position key contributed by the side to move, the castling
+ *	rights and the en passant target. Castling rights are keyed on the rook file of each xFEN
+ *	slot, so Chess960 rights on different rooks hash differently. The en passant target is only
+ *	keyed when a pawn of the side to move can capture on it, positions that differ only in a
+ *	target nobody can use are the same position.
+ *
+ *	@param position The position in compact format.
+ *	@param sideToMove The color of the side to move.
+ *	@param castlingStatus 4-char xFEN castling string(e.g. "HAha"), '-' for a lost right.
+ *	@param enPassantTarget The en passant target square, 0 if there is none.
+ *
+ *	@return The key of the side to move, castling and en passant state.
+ */
+sskZobristKey sskZobristKeyForStateInPosition(const sskPosition * position, sskChessColor sideToMove, const char castlingStatus[5], sskChessSquare enPassantTarget);
+
+/**
+ *	Function computes the full Zobrist key of a position from scratch, the XOR of
+ *	sskZobristKeyForPiecesInPosition() and sskZobristKeyForStateInPosition().
+ *
+ *	@return The 64-bit position key.
+ */
+sskZobristKey sskZobristKeyForPosition(const sskPosition * position, sskChessColor sideToMove, const char castlingStatus[5], sskChessSquare enPassantTarget);
+
+#pragma mark - Material Functions
+
+/**
+ *	Material key fields, one 4-bit count per color and slot at bit (color * 24 + slot * 4).
+ *	Bishops are counted per square color, which is what decides dead bishop endings.
+ */
+enum {
+	sskMaterialSlotPawn = 0,
+	sskMaterialSlotKnight,
+	sskMaterialSlotLightBishop,
+	sskMaterialSlotDarkBishop,
+	sskMaterialSlotRook,
+	sskMaterialSlotQueen
+};
+
+/** Returns the count in a material key for a color(0/1) and an sskMaterialSlot. */
+#define SSK_GET_MATERIAL_COUNT(materialKey, color, slot) (((materialKey) >> ((color) * 24 + (slot) * 4)) & 15)
+
+/** Bitmap of the light squares(b1, a2, ...). */
+#define SSK_LIGHT_SQUARES_BITMAP 0x55AA55AA55AA55AAULL
+
+/**
+ *	Endgame classes by the kinds of pieces left, for routing positions to specialized code. A
+ *	position is only an endgame when each side has at most two pieces besides king and pawns.
+ */
+enum {
+	sskEndgameClassNone = 0,		/** Not an endgame */
+	sskEndgameClassPawn,			/** Kings and pawns only, bare kings included */
+	sskEndgameClassMinorPiece,		/** Knights and bishops, with or without pawns */
+	sskEndgameClassRook,			/** Rooks, with or without pawns */
+	sskEndgameClassRookAndMinor,	/** Rooks and minor pieces, with or without pawns */
+	sskEndgameClassQueen			/** Queens with anything else */
+};
+typedef unsigned short sskEndgameClass;
+
+/**
+ *	Material class of a position: the endgame class in the low bits and
+ *	SSK_MATERIAL_CLASS_DEAD_FLAG when neither side can ever mate.
+ */
+typedef unsigned char sskMaterialClass;
+
+#define SSK_MATERIAL_CLASS_DEAD_FLAG 0x80
+
+/** Returns kTrue if a material class is dead by insufficient material. */
+#define SSK_IS_MATERIAL_CLASS_DEAD(materialClass) (((materialClass) & SSK_MATERIAL_CLASS_DEAD_FLAG) ? kTrue : kFalse)
+
+/** Returns the sskEndgameClass of a material class. */
+#define SSK_GET_ENDGAME_CLASS(materialClass) ((sskEndgameClass)((materialClass) & 0x0F))
+
+/**
+ *	Function returns the material key units of a piece standing on a square. Add it when the
+ *	piece appears and subtract it when it leaves the board, the fields never wrap.
+ *
+ *	@param piece The 4-bit piece code. Kings and sskChessPieceNone are not counted.
+ *	@param squareIndex The square index(0-63), only looked at for bishops.
+ *
+ *	@return The units to add to or subtract from a material key.
+ */
+static inline sskMaterialKey sskMaterialKeyForPieceOnSquare(sskChessPiece piece, sskChessSquare squareIndex) {
+	int slot;
+	
+	switch (SSK_GET_GENERIC_PIECE_CODE(piece)) {
+		case sskChessPiecePawn: slot = sskMaterialSlotPawn; break;
+		case sskChessPieceKnight: slot = sskMaterialSlotKnight; break;
+		case sskChessPieceBishop: slot = (SSK_LIGHT_SQUARES_BITMAP & SSK_BITMAP_SET_SQUARE_IDX(squareIndex)) ? sskMaterialSlotLightBishop : sskMaterialSlotDarkBishop; break;
+		case sskChessPieceRook: slot = sskMaterialSlotRook; break;
+		case sskChessPieceQueen: slot = sskMaterialSlotQueen; break;
+		default: return 0;
+	}
+	
+	return 1ULL << (SSK_GET_PIECE_COLOR(piece) * 24 + slot * 4);
+}
+
+/**
+ *	Function computes the material key of a position from scratch. Keep it up to date across
+ *	moves by adding the units of the pieces that appear and subtracting those that leave.
+ *
+ *	@param position The position in compact format.
+ *
+ *	@return The packed piece counts.
+ */
+sskMaterialKey sskMaterialKeyForPosition(const sskPosition * position);
+
+/**
+ *	Function classifies a material key with a single lookup in a table built by
+ *	sskInitBitboards(). Dead by material are: bare kings, a single minor piece, and any
+ *	number of bishops that all stand on squares of one color.
+ *
+ *	@param materialKey The material key of the position.
+ *
+ *	@return The material class, use SSK_IS_MATERIAL_CLASS_DEAD() and SSK_GET_ENDGAME_CLASS().
+ */
+sskMaterialClass sskMaterialClassForKey(sskMaterialKey materialKey);
+
 #endif
@@ -0,0 +1,230 @@
+/**
+ *	@file
+ *	C++ layer over bitboard.h. Generates the knight, king, pawn and ray lookup tables with
+ *	constexpr functions (checked against the hand written tables in bitboard.c) and provides
+ *	attack, check and pin kernels specialized per color and piece type through templates.
+ *	Requires C++14.
+ *
+ *	@author Santhosbaala RS
+ *	@copyright 2012 64cloud
+ *	@version 0.1
+ */
+
+#ifndef bitboard_hpp
+#define bitboard_hpp
+
+extern "C" {
+#include "bitboard.h"
+}
+
+namespace ssk {
+
+#pragma mark - Generated Tables
+
+/** A lookup table with one bitmap per square(a1-h8), usable in constant expressions. */
+struct BitmapTable {
+	sskBitmap entries[64];
+
+	constexpr sskBitmap operator[](sskChessSquare squareIndex) const { return entries[squareIndex]; }
+};
+
+namespace detail {
+	/** Returns the bit of the square fileOffset/rankOffset away from squareIndex, or 0 if that is off the board. */
+	constexpr sskBitmap stepFrom(int squareIndex, int fileOffset, int rankOffset) {
+		return ((squareIndex & 7) + fileOffset >= 0 && (squareIndex & 7) + fileOffset < 8 &&
+				(squareIndex >> 3) + rankOffset >= 0 && (squareIndex >> 3) + rankOffset < 8) ?
+			   ((sskBitmap)1 << (squareIndex + rankOffset * 8 + fileOffset)) : 0;
+	}
+
+	/** Generates a table of single steps from every square, offsets given as file/rank pairs. */
+	template <int NumSteps>
+	constexpr BitmapTable makeStepTable(const int (&steps)[NumSteps][2]) {
+		BitmapTable table = {};
+		for (int square = 0; square < 64; square++) {
+			for (int i = 0; i < NumSteps; i++) table.entries[square] |= stepFrom(square, steps[i][0], steps[i][1]);
+		}
+		return table;
+	}
+
+	/** Generates the rays walking from every square in one direction, excluding the square itself. */
+	constexpr BitmapTable makeRayTable(int fileOffset, int rankOffset) {
+		BitmapTable table = {};
+		for (int square = 0; square < 64; square++) {
+			for (int file = (square & 7) + fileOffset, rank = (square >> 3) + rankOffset;
+				 file >= 0 && file < 8 && rank >= 0 && rank < 8;
+				 file += fileOffset, rank += rankOffset) {
+				table.entries[square] |= (sskBitmap)1 << (rank * 8 + file);
+			}
+		}
+		return table;
+	}
+
+	/** Pawn reach as in bitboard.c: single push, double push from the start rank and both captures, empty on the back ranks. */
+	constexpr BitmapTable makePawnReachTable(sskChessColor pawnColor) {
+		BitmapTable table = {};
+		const int forward = (pawnColor == sskChessColorWhite) ? 1 : -1;
+		const int startRank = (pawnColor == sskChessColorWhite) ? 1 : 6;
+		for (int square = 8; square < 56; square++) {
+			table.entries[square] = stepFrom(square, -1, forward) | stepFrom(square, 0, forward) | stepFrom(square, 1, forward);
+			if ((square >> 3) == startRank) table.entries[square] |= stepFrom(square, 0, 2 * forward);
+		}
+		return table;
+	}
+
+	constexpr int knightSteps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+	constexpr int kingSteps[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+}
+
+constexpr BitmapTable knightReach = detail::makeStepTable(detail::knightSteps);
+constexpr BitmapTable kingReach = detail::makeStepTable(detail::kingSteps);
+constexpr BitmapTable whitePawnReach = detail::makePawnReachTable(sskChessColorWhite);
+constexpr BitmapTable blackPawnReach = detail::makePawnReachTable(sskChessColorBlack);
+constexpr BitmapTable northFile = detail::makeRayTable(0, 1);
+constexpr BitmapTable southFile = detail::makeRayTable(0, -1);
+constexpr BitmapTable eastRank = detail::makeRayTable(1, 0);
+constexpr BitmapTable westRank = detail::makeRayTable(-1, 0);
+constexpr BitmapTable northEastDiagonal = detail::makeRayTable(1, 1);
+constexpr BitmapTable northWestDiagonal = detail::makeRayTable(-1, 1);
+constexpr BitmapTable southEastDiagonal = detail::makeRayTable(1, -1);
+constexpr BitmapTable southWestDiagonal = detail::makeRayTable(-1, -1);
+
+// Spot checks against the hex tables in bitboard.c, verifyGeneratedTables() compares every entry.
+static_assert(knightReach[0] == 0x0000000000020400 && knightReach[27] == 0x0000142200221400, "knight reach table");
+static_assert(kingReach[0] == 0x0000000000000302 && kingReach[7] == 0x000000000000c040, "king reach table");
+static_assert(whitePawnReach[8] == 0x0000000001030000 && whitePawnReach[16] == 0x0000000003000000, "white pawn reach table");
+static_assert(blackPawnReach[48] == 0x0000030100000000 && blackPawnReach[8] == 0x0000000000000003, "black pawn reach table");
+static_assert(northFile[0] == 0x0101010101010100 && northEastDiagonal[0] == 0x8040201008040200, "ray tables");
+
+/**
+ *	Function compares every entry of the generated tables with the lookup functions of bitboard.c.
+ *
+ *	@return true if all the tables agree, else false.
+ */
+inline bool verifyGeneratedTables() {
+	for (sskChessSquare square = 0; square < 64; square++) {
+		if (knightReach[square] != sskBitmapWithKnightReach(square) ||
+			kingReach[square] != sskBitmapWithKingReach(square) ||
+			whitePawnReach[square] != sskBitmapWithPawnReach(square, sskChessColorWhite) ||
+			blackPawnReach[square] != sskBitmapWithPawnReach(square, sskChessColorBlack) ||
+			northFile[square] != sskBitmapWithNorthFile(square) ||
+			southFile[square] != sskBitmapWithSouthFile(square) ||
+			eastRank[square] != sskBitmapWithEastRank(square) ||
+			westRank[square] != sskBitmapWithWestRank(square) ||
+			northEastDiagonal[square] != sskBitmapWithNorthEastDiagonal(square) ||
+			northWestDiagonal[square] != sskBitmapWithNorthWestDiagonal(square) ||
+			southEastDiagonal[square] != sskBitmapWithSouthEastDiagonal(square) ||
+			southWestDiagonal[square] != sskBitmapWithSouthWestDiagonal(square)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#pragma mark - Side Traits
+
+/** Maps a color to the bitmaps of its pieces in an sskBitboardPosition, resolved at compile time. */
+template <sskChessColor Color> struct Side;
+
+template <> struct Side<sskChessColorWhite> {
+	static constexpr sskChessColor opponent = sskChessColorBlack;
+
+	static sskBitmap pawns(const sskBitboardPosition & position) { return position.wPawn; }
+	static sskBitmap king(const sskBitboardPosition & position) { return position.wKing; }
+	static sskBitmap queens(const sskBitboardPosition & position) { return position.wQueen; }
+	static sskBitmap rooks(const sskBitboardPosition & position) { return position.wRook; }
+	static sskBitmap bishops(const sskBitboardPosition & position) { return position.wBishop; }
+	static sskBitmap knights(const sskBitboardPosition & position) { return position.wKnight; }
+	static sskBitmap occupied(const sskBitboardPosition & position) { return position.wOccupied; }
+
+	static constexpr sskBitmap pawnAttacks(sskBitmap pawns) {
+		return ((pawns << 7) & 0x7f7f7f7f7f7f7f7f) | ((pawns << 9) & 0xfefefefefefefefe);
+	}
+};
+
+template <> struct Side<sskChessColorBlack> {
+	static constexpr sskChessColor opponent = sskChessColorWhite;
+
+	static sskBitmap pawns(const sskBitboardPosition & position) { return position.bPawn; }
+	static sskBitmap king(const sskBitboardPosition & position) { return position.bKing; }
+	static sskBitmap queens(const sskBitboardPosition & position) { return position.bQueen; }
+	static sskBitmap rooks(const sskBitboardPosition & position) { return position.bRook; }
+	static sskBitmap bishops(const sskBitboardPosition & position) { return position.bBishop; }
+	static sskBitmap knights(const sskBitboardPosition & position) { return position.bKnight; }
+	static sskBitmap occupied(const sskBitboardPosition & position) { return position.bOccupied; }
+
+	static constexpr sskBitmap pawnAttacks(sskBitmap pawns) {
+		return ((pawns >> 9) & 0x7f7f7f7f7f7f7f7f) | ((pawns >> 7) & 0xfefefefefefefefe);
+	}
+};
+
+#pragma mark - Specialized Kernels
+
+/**
+ *	Squares attacked by a piece of the given color coded type(sskChessPieceWKnight...) standing on
+ *	squareIndex. Pawns return their captures only. The piece type is a template argument, so each
+ *	instantiation compiles down to the single lookup of that piece.
+ */
+template <sskChessPiece Piece>
+inline sskBitmap pieceAttacks(sskChessSquare squareIndex, sskBitmap occupied) {
+	switch (SSK_GET_GENERIC_PIECE_CODE(Piece)) {
+		case sskChessPiecePawn: return Side<SSK_GET_PIECE_COLOR(Piece)>::pawnAttacks((sskBitmap)1 << squareIndex);
+		case sskChessPieceKnight: return knightReach[squareIndex];
+		case sskChessPieceKing: return kingReach[squareIndex];
+		case sskChessPieceRook: return sskBitmapWithRookAttacks(squareIndex, occupied);
+		case sskChessPieceBishop: return sskBitmapWithBishopAttacks(squareIndex, occupied);
+		case sskChessPieceQueen: return sskBitmapWithQueenAttacks(squareIndex, occupied);
+		default: return SSK_EMPTY_BITMAP;
+	}
+}
+
+/** Pieces of Color attacking squareIndex, see sskBitmapWithAttackersTo(). */
+template <sskChessColor Color>
+inline sskBitmap attackersTo(const sskBitboardPosition & position, sskChessSquare squareIndex, sskBitmap occupied) {
+	typedef Side<Color> Us;
+
+	return (Side<Us::opponent>::pawnAttacks((sskBitmap)1 << squareIndex) & Us::pawns(position)) |
+		   (knightReach[squareIndex] & Us::knights(position)) |
+		   (kingReach[squareIndex] & Us::king(position)) |
+		   (sskBitmapWithRookAttacks(squareIndex, occupied) & (Us::rooks(position) | Us::queens(position))) |
+		   (sskBitmapWithBishopAttacks(squareIndex, occupied) & (Us::bishops(position) | Us::queens(position)));
+}
+
+/** Every square attacked by Color, see sskBitmapWithSquaresAttackedBySide(). */
+template <sskChessColor Color>
+inline sskBitmap attackedBy(const sskBitboardPosition & position, sskBitmap occupied) {
+	typedef Side<Color> Us;
+
+	return Us::pawnAttacks(Us::pawns(position)) |
+		   sskBitmapWithKnightSetAttacks(Us::knights(position)) |
+		   sskBitmapWithKingSetAttacks(Us::king(position)) |
+		   sskBitmapWithRookSetAttacks(Us::rooks(position) | Us::queens(position), occupied) |
+		   sskBitmapWithBishopSetAttacks(Us::bishops(position) | Us::queens(position), occupied);
+}
+
+/** Opponent pieces giving check to the king of KingColor, including the opponent king. */
+template <sskChessColor KingColor>
+inline sskBitmap checkers(const sskBitboardPosition & position) {
+	return attackersTo<Side<KingColor>::opponent>(position, sskFirstOneIndex(Side<KingColor>::king(position)), position.occupied);
+}
+
+/**
+ *	Whether the piece of Color on pinnedSquare is pinned against behindSquare by an opponent
+ *	slider, see sskIsSquarePinned(). Requires the line tables built by sskInitBitboards().
+ */
+template <sskChessColor Color>
+inline bool isPinned(const sskBitboardPosition & position, sskChessSquare pinnedSquare, sskChessSquare behindSquare) {
+	typedef Side<Side<Color>::opponent> Them;
+
+	sskBitmap between = sskBitmapWithSquaresBetween(behindSquare, pinnedSquare);
+	sskBitmap occupied = position.occupied | ((sskBitmap)1 << behindSquare);
+
+	if (sskBitmapWithLine(behindSquare, pinnedSquare) == SSK_EMPTY_BITMAP || (between & position.occupied)) return false;
+
+	return (((sskBitmapWithRookAttacks(pinnedSquare, occupied) & (Them::rooks(position) | Them::queens(position))) |
+			 (sskBitmapWithBishopAttacks(pinnedSquare, occupied) & (Them::bishops(position) | Them::queens(position)))) &
+			sskBitmapWithLine(behindSquare, pinnedSquare) & ~between & ~((sskBitmap)1 << behindSquare)) != SSK_EMPTY_BITMAP;
+}
+
+}
+
+#endif
@@ -8,6 +8,7 @@
  */
 
 #include "boardformatconvertutil.h"
+#include "allocation.h"
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -15,7 +16,7 @@
 sskBitboardPosition * sskOffsetPositionToBitboardPosition(sskOffsetPosition offsetPosition) {
 	int i;
 	
-	sskBitboardPosition * pos = malloc(sizeof(sskBitboardPosition));
+	sskBitboardPosition * pos = SSK_MALLOC(sizeof(sskBitboardPosition));
 	pos->wKing = (sskBitmap)0x0;
 	pos->wQueen = (sskBitmap)0x0;
 	pos->wRook = (sskBitmap)0x0;
@@ -92,8 +93,8 @@ sskBitboardPosition * sskOffsetPositionToBitboardPosition(sskOffsetPosition offs
 	return pos;
 }
 
-sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboardPosition) {
-	sskOffsetPosition offsetPosition = (sskOffsetPosition)malloc(sizeof(sskChessPiece) * 64);
+sskOffsetPosition sskBitboardPositionToOffsetPositionRef(const sskBitboardPosition * bitboardPosition) {
+	sskOffsetPosition offsetPosition = (sskOffsetPosition)SSK_MALLOC(sizeof(sskChessPiece) * 64);
 	sskChessPiece i;
 	sskBitmap pieceBitboard;
 	sskChessSquare square;
@@ -103,7 +104,7 @@ sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboa
 
 	// White Pieces
 	for (i = sskChessPieceWPawn; i <= sskChessPieceWKnight; i++) {
-		pieceBitboard = sskBitmapForPieceInBitboardPosition(bitboardPosition, i);
+		pieceBitboard = sskBitmapForPieceInBitboardPositionRef(bitboardPosition, i);
 		while (pieceBitboard) {
 			square = sskFirstOneIndex(pieceBitboard);
 			pieceBitboard = pieceBitboard & SSK_BITMAP_UNSET_SQUARE_IDX(square);
@@ -113,7 +114,7 @@ sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboa
 	
 	// Black Pieces
 	for (i = sskChessPieceBPawn; i <= sskChessPieceBKnight; i++) {
-		pieceBitboard = sskBitmapForPieceInBitboardPosition(bitboardPosition, i);
+		pieceBitboard = sskBitmapForPieceInBitboardPositionRef(bitboardPosition, i);
 		while (pieceBitboard) {
 			square = sskFirstOneIndex(pieceBitboard);
 			pieceBitboard = pieceBitboard & SSK_BITMAP_UNSET_SQUARE_IDX(square);
@@ -124,6 +125,33 @@ sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboa
 	return offsetPosition;
 }
 
+sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboardPosition) {
+	return sskBitboardPositionToOffsetPositionRef(&bitboardPosition);
+}
+
+void sskOffsetPositionToPosition(sskOffsetPosition offsetPosition, sskPosition * position) {
+	int i;
+	
+	memset(position, 0, sizeof(sskPosition));
+	
+	for (i = 0; i < 64; i++) {
+		if (SSK_GET_GENERIC_PIECE_CODE(offsetPosition[i]) == sskChessPieceNone) continue;
+		
+		position->pieces[SSK_GET_GENERIC_PIECE_CODE(offsetPosition[i]) - 1] |= SSK_BITMAP_SET_SQUARE_IDX(i);
+		position->colors[SSK_GET_PIECE_COLOR(offsetPosition[i])] |= SSK_BITMAP_SET_SQUARE_IDX(i);
+		position->mailbox[i] = offsetPosition[i];
+	}
+}
+
+sskOffsetPosition sskPositionToOffsetPosition(const sskPosition * position) {
+	sskOffsetPosition offsetPosition = (sskOffsetPosition)SSK_MALLOC(sizeof(sskChessPiece) * 64);
+	int i;
+	
+	for (i = 0; i < 64; i++) offsetPosition[i] = position->mailbox[i];
+	
+	return offsetPosition;
+}
+
 void sskFillPiecePlacementWithOffsetPosition(char piecePlacement[65], sskOffsetPosition offsetPosition) {
 	int i;
 	
@@ -176,8 +204,17 @@ void sskFillPiecePlacementWithOffsetPosition(char piecePlacement[65], sskOffsetP
 	piecePlacement[64] = '\0';
 }
 
+void sskFillPiecePlacementWithPosition(char piecePlacement[65], const sskPosition * position) {
+	static const char symbols[16] = "1PKQRBN11pkqrbn1";
+	int i;
+	
+	for (i = 0; i < 64; i++) piecePlacement[i] = symbols[position->mailbox[i] & 15];
+	
+	piecePlacement[64] = '\0';
+}
+
 sskOffsetPosition sskPiecePlacementStringToOffsetPosition(const char piecePlacement[65]) {
-	sskOffsetPosition offsetPosition = (sskOffsetPosition)malloc(sizeof(sskChessPiece) * 64);
+	sskOffsetPosition offsetPosition = (sskOffsetPosition)SSK_MALLOC(sizeof(sskChessPiece) * 64);
 	int i;
 	
 	// Clear the board
@@ -33,6 +33,27 @@ sskBitboardPosition * sskOffsetPositionToBitboardPosition(sskOffsetPosition offs
  */
 sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboardPosition);
 
+/** Const pointer variant of sskBitboardPositionToOffsetPosition(). */
+sskOffsetPosition sskBitboardPositionToOffsetPositionRef(const sskBitboardPosition * bitboardPosition);
+
+/**
+ *	Function converts an offset position to a compact position.
+ *
+ *	@param offsetPosition The position in offset format.
+ *	@param position Out param, filled with the position in compact format.
+ */
+void sskOffsetPositionToPosition(sskOffsetPosition offsetPosition, sskPosition * position);
+
+/**
+ *	Function converts a compact position to an offset position. Memory deallocation
+ *	is the responsibility of the caller.
+ *
+ *	@param position The position in compact format.
+ *
+ *	@return A pointer to the newly created offset position or NULL on failure.
+ */
+sskOffsetPosition sskPositionToOffsetPosition(const sskPosition * position);
+
 /**
  *	Function fills the given piecePlacement string with the information from an offsetPosition.
  *
@@ -41,6 +62,14 @@ sskOffsetPosition sskBitboardPositionToOffsetPosition(sskBitboardPosition bitboa
  */
 void sskFillPiecePlacementWithOffsetPosition(char piecePlacement[65], sskOffsetPosition offsetPosition);
 
+/**
+ *	Function fills the given piecePlacement string from the mailbox of a compact position.
+ *
+ *	@param piecePlacement The piecePlacement string to be filled.
+ *	@param position The position in compact format.
+ */
+void sskFillPiecePlacementWithPosition(char piecePlacement[65], const sskPosition * position);
+
 /**
  *	Function converts the given piece placement string to an offset position. Caller has to
  *	manage memory.
@@ -8,13 +8,14 @@
  */
 
 #include "ChessSquare.h"
+#include "allocation.h"
 #include <stdlib.h>
 
 char * sskSquareToLabel(sskChessSquare aSquareIndex) {
 	char * label = NULL;
 	
 	if (aSquareIndex <= 63) {
-		label = (char *)malloc(sizeof(char) * 3);
+		label = (char *)SSK_MALLOC(sizeof(char) * 3);
 		label[0] = 'a' + SSK_GET_FILE_IDX(aSquareIndex);
 		label[1] = '1' + SSK_GET_RANK_IDX(aSquareIndex);
 		label[2] = '\0';
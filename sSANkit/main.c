@@ -2,12 +2,229 @@
 
 #include <time.h>
 
+/**
+ *	Times each sliding attack backend available on this build and CPU, first on raw attack lookups
+ *	over random occupancies, then on full semantic analysis of the given game.
+ */
+static void benchmarkSlidingAttacks(char * input) {
+	static const char * backendNames[] = {"ray", "magic", "pext"};
+	const int lookupRounds = 200000, analysisRounds = 2000;
+	sskSlidingAttacksBackend backend, defaultBackend = sskCurrentSlidingAttacksBackend();
+	sskBitmap occupancies[64], checksum, seed = 0x9E3779B97F4A7C15;
+	clock_t begin, end;
+	int i, round, errorIndex, ambiguousHalfmoveNumber;
+	
+	// Random occupancies with about a quarter of the squares filled, like a middlegame.
+	for (i = 0; i < 64; i++) {
+		seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+		occupancies[i] = seed * 0x2545F4914F6CDD1D;
+		seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+		occupancies[i] &= seed * 0x2545F4914F6CDD1D;
+	}
+	
+	printf("\n Default sliding attack backend: %s", backendNames[defaultBackend]);
+	
+	for (backend = sskSlidingAttacksBackendRay; backend <= sskSlidingAttacksBackendPext; backend++) {
+		if (!sskSetSlidingAttacksBackend(backend)) {
+			printf("\n %-6s not available", backendNames[backend]);
+			continue;
+		}
+		
+		checksum = 0;
+		begin = clock();
+		for (round = 0; round < lookupRounds; round++) {
+			for (i = 0; i < 64; i++) {
+				checksum ^= sskBitmapWithQueenAttacks(i, occupancies[(i + round) & 63]);
+			}
+		}
+		end = clock();
+		printf("\n %-6s %d queen lookups: %f second(s) (checksum %016llx, verified %d)", backendNames[backend], lookupRounds * 64,
+			   (float)(end-begin)/CLOCKS_PER_SEC, checksum, sskVerifySlidingAttacks(64));
+		
+		clock_t analysisTime = 0;
+		for (round = 0; round < analysisRounds; round++) {
+			sskMoveList list = sskLexicalAnalyze(input, &errorIndex, 0, sskChessColorWhite);
+			if (list == NULL) break;
+			strcpy(list->castlingStatus, "HAha");
+			list->enPassantTarget = 0;
+			list->pawnHalfMoves = 0;
+			
+			begin = clock();
+			sskSemanticAnalyze(list, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", &ambiguousHalfmoveNumber);
+			analysisTime += clock() - begin;
+			
+			sskFreeMoveList(&list);
+		}
+		printf("\n %-6s %d semantic analyses: %f second(s)", backendNames[backend], analysisRounds, (float)analysisTime/CLOCKS_PER_SEC);
+	}
+	
+	sskSetSlidingAttacksBackend(defaultBackend);
+	printf("\n");
+}
+
+/**
+ *	Times the by-value query functions against their const pointer variants on every position
+ *	of the given game, so the cost of copying the 120 byte position per call shows up.
+ */
+static void benchmarkPositionPassing(char * input) {
+	const int rounds = 20000;
+	sskBitboardPosition * positions[1024];
+	int numPositions = 0, round, i, errorIndex, ambiguousHalfmoveNumber;
+	sskChessPiece piece;
+	sskBitmap checksum[2] = {0, 0};
+	clock_t begin, byValueTime, byRefTime;
+	
+	sskMoveList list = sskLexicalAnalyze(input, &errorIndex, 0, sskChessColorWhite);
+	if (list == NULL) return;
+	strcpy(list->castlingStatus, "HAha");
+	list->enPassantTarget = 0;
+	list->pawnHalfMoves = 0;
+	
+	if (sskSemanticAnalyze(list, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", &ambiguousHalfmoveNumber) == sskSemanticAnalyzerErrorNone) {
+		for (sskMove * trav = list; trav && numPositions < 1024; trav = trav->next) {
+			positions[numPositions++] = sskPiecePlacementStringToBitboardPosition(trav->piecePlacementAfterMove);
+		}
+	}
+	sskFreeMoveList(&list);
+	
+	begin = clock();
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < numPositions; i++) {
+			checksum[0] += sskIsKingUnderCheck(*positions[i], round & 1, kTrue, NULL);
+			checksum[0] += sskCanKingEscape(*positions[i], round & 1);
+			for (piece = sskChessPieceWPawn; piece <= sskChessPieceBKnight; piece++) {
+				checksum[0] ^= sskBitmapForPieceInBitboardPosition(*positions[i], piece);
+			}
+		}
+	}
+	byValueTime = clock() - begin;
+	
+	begin = clock();
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < numPositions; i++) {
+			checksum[1] += sskIsKingUnderCheckRef(positions[i], round & 1, kTrue, NULL);
+			checksum[1] += sskCanKingEscapeRef(positions[i], round & 1);
+			for (piece = sskChessPieceWPawn; piece <= sskChessPieceBKnight; piece++) {
+				checksum[1] ^= sskBitmapForPieceInBitboardPositionRef(positions[i], piece);
+			}
+		}
+	}
+	byRefTime = clock() - begin;
+	
+	printf("\n %d positions x %d rounds, by value: %f second(s), by const pointer: %f second(s)%s", numPositions, rounds,
+		   (float)byValueTime/CLOCKS_PER_SEC, (float)byRefTime/CLOCKS_PER_SEC, (checksum[0] == checksum[1])?"":" (MISMATCH)");
+	printf("\n");
+	
+	for (i = 0; i < numPositions; i++) free(positions[i]);
+}
+
+/** Returns kTrue if two analysed moves carry the same results. */
+static kBool isSameAnalysis(const sskMove * move, const sskMove * otherMove) {
+	return (move->halfmove == otherMove->halfmove && move->pieceMoved == otherMove->pieceMoved &&
+			move->fromSquare == otherMove->fromSquare && move->toSquare == otherMove->toSquare &&
+			move->promotedPiece == otherMove->promotedPiece && move->capturedPiece == otherMove->capturedPiece &&
+			move->castlingType == otherMove->castlingType &&
+			move->selfKingStatus == otherMove->selfKingStatus && move->opponentKingStatus == otherMove->opponentKingStatus &&
+			move->didUpdateSelfKingStatus == otherMove->didUpdateSelfKingStatus &&
+			move->didUpdateOpponentKingStatus == otherMove->didUpdateOpponentKingStatus &&
+			strcmp(move->piecePlacementBeforeMove, otherMove->piecePlacementBeforeMove) == 0 &&
+			strcmp(move->piecePlacementAfterMove, otherMove->piecePlacementAfterMove) == 0 &&
+			move->enPassantTarget == otherMove->enPassantTarget && move->pawnHalfMoves == otherMove->pawnHalfMoves &&
+			strcmp(move->castlingStatus, otherMove->castlingStatus) == 0 &&
+			move->positionKeyBeforeMove == otherMove->positionKeyBeforeMove && move->positionKeyAfterMove == otherMove->positionKeyAfterMove &&
+			move->positionRepetitions == otherMove->positionRepetitions && move->drawStatus == otherMove->drawStatus &&
+			move->materialKeyAfterMove == otherMove->materialKeyAfterMove && move->endgameClassAfterMove == otherMove->endgameClassAfterMove) ? kTrue : kFalse;
+}
+
+/**
+ *	Analyses the given game and games that continue after checkmate with sskSemanticAnalyzeWithOptions()
+ *	and with sskSemanticAnalyzeInParallel() on 1 to 4 threads, at every analysis level, and reports
+ *	every run whose error or moves differ.
+ */
+static void compareParallelAnalysis(char * input) {
+	char * games[] = {input, "f3 e5 g4 Qh4 a3", "e4 e5 Bc4 Nc6 Qh5 Nf6 Qf7 Ke7"};
+	sskSemanticAnalyzerOptions levels[] = {sskSemanticAnalyzerLevelFull, sskSemanticAnalyzerLevelGameEnd, sskSemanticAnalyzerLevelChecks, sskSemanticAnalyzerLevelLegality};
+	int game, level, errorIndex, numMismatches = 0;
+	unsigned int numThreads;
+	
+	for (game = 0; game < (int)(sizeof(games) / sizeof(games[0])); game++) {
+		for (level = 0; level < (int)(sizeof(levels) / sizeof(levels[0])); level++) {
+			for (numThreads = 1; numThreads <= 4; numThreads++) {
+				int ambiguousHalfmoveNumber = -1, parallelAmbiguousHalfmoveNumber = -1;
+				sskMoveList list = sskLexicalAnalyze(games[game], &errorIndex, 0, sskChessColorWhite);
+				sskMoveList parallelList = sskLexicalAnalyze(games[game], &errorIndex, 0, sskChessColorWhite);
+				if (list == NULL || parallelList == NULL) return;
+				strcpy(list->castlingStatus, "HAha");
+				strcpy(parallelList->castlingStatus, "HAha");
+				
+				sskSemanticAnalyzerError error = sskSemanticAnalyzeWithOptions(list, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", levels[level], &ambiguousHalfmoveNumber);
+				sskSemanticAnalyzerError parallelError = sskSemanticAnalyzeInParallel(parallelList, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", levels[level], numThreads, &parallelAmbiguousHalfmoveNumber);
+				
+				kBool isSame = (error == parallelError && ambiguousHalfmoveNumber == parallelAmbiguousHalfmoveNumber) ? kTrue : kFalse;
+				sskMove * trav = list, * parallelTrav = parallelList;
+				for (; trav != NULL && parallelTrav != NULL; trav = trav->next, parallelTrav = parallelTrav->next) {
+					if (!isSameAnalysis(trav, parallelTrav)) isSame = kFalse;
+				}
+				
+				if (!isSame) {
+					printf("\n Game %d, level %u, %u thread(s): parallel analysis differs (error %d, parallel error %d)", game, levels[level], numThreads, error, parallelError);
+					numMismatches++;
+				}
+				
+				sskFreeMoveList(&list);
+				sskFreeMoveList(&parallelList);
+			}
+		}
+	}
+	
+	printf("\n Parallel analysis: %d mismatch(es)\n", numMismatches);
+}
+
+/**
+ *	Analyses a Chess960 game whose king castles onto its own rook's square and reports whether the
+ *	castling came out as a capture or reset the halfmove clock.
+ */
+static void checkChess960CastlingOntoRook(void) {
+	int errorIndex, ambiguousHalfmoveNumber = -1;
+	sskMove * castlingMove;
+	
+	// King f1 and rook g1, so OO moves the king to g1 and the rook to f1.
+	sskMoveList list = sskLexicalAnalyze("Ng3 Ng6 OO Nh8", &errorIndex, 0, sskChessColorWhite);
+	if (list == NULL) return;
+	strcpy(list->castlingStatus, "GAga");
+	
+	sskSemanticAnalyzerError error = sskSemanticAnalyze(list, "rnbqbkrn/pppppppp/8/8/8/8/PPPPPPPP/RNBQBKRN", &ambiguousHalfmoveNumber);
+	castlingMove = list->next->next;
+	
+	if (error != sskSemanticAnalyzerErrorNone || castlingMove->castlingType == sskCastlingTypeNone) {
+		printf("\n Chess960 castling onto the rook: analysis failed (error %d)", error);
+	} else if (castlingMove->capturedPiece != sskChessPieceNone || castlingMove->next->pawnHalfMoves != 3) {
+		printf("\n Chess960 castling onto the rook: reported capture %d, next halfmove clock %d", castlingMove->capturedPiece, castlingMove->next->pawnHalfMoves);
+	} else {
+		printf("\n Chess960 castling onto the rook: ok");
+	}
+	printf("\n");
+	
+	sskFreeMoveList(&list);
+}
+
 int main(int argc, const char * argv[]) {
 	
 	clock_t begin, end;
 	
 	char * input = NULL;
 	
+	kBool runBenchmark = (argv[1] != NULL && strcmp(argv[1], "-benchmark") == 0);
+	if (runBenchmark) argv++;
+	
+	kBool runParallelComparison = (argv[1] != NULL && strcmp(argv[1], "-parallel") == 0);
+	if (runParallelComparison) argv++;
+	
+	if (argv[1] != NULL && strcmp(argv[1], "-chess960") == 0) {
+		checkChess960CastlingOntoRook();
+		return 0;
+	}
+	
 	if (argv[1] != NULL) {
 		input = (char *)argv[1];
 	} else {
@@ -17,6 +234,17 @@ int main(int argc, const char * argv[]) {
 		input = "d4 Nf6 c4 g6 Nc3 d5 cd5 Nd5 e4 Nc3 bc3 Bg7 Bc4 c5 Ne2 Nc6 Be3 OO OO b6 dc5 Qc7 f4 bc5 Rb1 Rd8 Qa4 Na5 Bd5 Bd7 Qa3 Rac8 f5 e6 Bf4 Be5 fe6 fe6 Bb3 Nb3 ab3 Rf8 Qc1 c4 b4 Qb6 Kh1 Bg7 e5 Bc6 Nd4 Bd5 Ra1 Qb7 Qc2 Rc7 Bg3 Rcf7 Rf7 Qf7 Qe2 g5 h3 h5 Kg1 h4 Bh2 Qg6 Rd1 g4 hg4 Qg5 Nf5 ef5 Rd5 fg4 Kh1 h3 gh3 gh3 Rd4 Qc1 Rd1 Qc3 e6 Qb2 Qe4 Qg2 Qg2 hg2 Kg2 Re8 Rd6 Bf8 Rc6 Bb4 Rc4 a5 Rc6 Kg7 Kf3 Kf6 Ke4 Re6 Be5 Kf7";
 	}
 	
+	if (runBenchmark) {
+		benchmarkSlidingAttacks(input);
+		benchmarkPositionPassing(input);
+		return 0;
+	}
+	
+	if (runParallelComparison) {
+		compareParallelAnalysis(input);
+		return 0;
+	}
+	
 	int errorIndex = 0;
 	
 	begin = clock();
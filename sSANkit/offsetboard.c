@@ -8,17 +8,24 @@
  */
 
 #include "offsetboard.h"
+#include "allocation.h"
 #include <stdio.h>	// For NULL
 #include <stdlib.h>	// For malloc() and free()
 #include <string.h>	// For memeset
 #include <ctype.h>	// For toupper() and tolower()
 
 sskOffsetPosition sskxFENtoOffsetPosition(char * xFENstring) {
-	sskOffsetPosition pos = NULL;
-	char * ptr = (char *)xFENstring;
-	int i, j;
+	sskOffsetPosition pos = SSK_MALLOC(sizeof(sskChessPiece) * 64);
+	
+	if (pos == NULL) return NULL;
 	
-	pos = malloc(sizeof(sskChessPiece) * 64);
+	sskFillOffsetPositionWithxFEN(pos, xFENstring);
+	return pos;
+}
+
+void sskFillOffsetPositionWithxFEN(sskChessPiece pos[64], const char * xFENstring) {
+	const char * ptr = xFENstring;
+	int i, j;
 	
 	// Clear the position
 	memset(pos, 0, sizeof(sskChessPiece) * 64);
@@ -29,7 +36,7 @@ sskOffsetPosition sskxFENtoOffsetPosition(char * xFENstring) {
 				case '/': j--; break;
 					
 				default:
-				case ' ': return pos;
+				case ' ': return;
 					
 				case '1': j += 0; break;
 				case '2': j += 1; break;
@@ -58,12 +65,10 @@ sskOffsetPosition sskxFENtoOffsetPosition(char * xFENstring) {
 			ptr += 1;
 		}
 	}
-	
-	return pos;
 }
 
 sskOffsetPosition sskCopyOffsetPosition(sskOffsetPosition offsetPosition) {
-	sskOffsetPosition copy = malloc(sizeof(sskChessPiece) * 64);
+	sskOffsetPosition copy = SSK_MALLOC(sizeof(sskChessPiece) * 64);
 	memcpy((void *)copy, (const void *)offsetPosition, sizeof(sskChessPiece) * 64);
 	return copy;
 }
@@ -28,6 +28,15 @@ typedef sskChessPiece * sskOffsetPosition; /** Represents an array of chess piec
  */
 sskOffsetPosition sskxFENtoOffsetPosition(char * xFENstring);
 
+/**
+ *	Variant of sskxFENtoOffsetPosition() writing into storage of the caller, a stack array for
+ *	instance, so that nothing is allocated.
+ *
+ *	@param offsetPosition The 64 squares(a1-h8) to fill.
+ *	@param xFENString The xFEN string with piece placement.
+ */
+void sskFillOffsetPositionWithxFEN(sskChessPiece offsetPosition[64], const char * xFENstring);
+
 /**
  *	Utility function to create a copy of the given offset position. Memory
  *	deallocation is the responsbility of the caller.
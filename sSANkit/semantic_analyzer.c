@@ -8,52 +8,334 @@
  */
 
 #include "semantic_analyzer.h"
+#include "lexer.h"
+#include "allocation.h"
+#include <assert.h>
+
+#if SSK_USE_PTHREADS
+#include <pthread.h>
+#endif
+
+/**
+ *	Generates the check, escape and pin kernels for the king of one side. Side/Opponent are the
+ *	name suffixes of the bitboard.h side kernels and us/them the constant colors, so the bodies
+ *	are free of color tests. The public functions pick the side once and call these.
+ */
+#define _SSK_DEFINE_SIDE_STATUS_KERNELS(Side, Opponent, us, them) \
+static sskBitmap _sskCheckingPiecesOn##Side##King(const sskPosition * position, kBool shouldIncludeKing) { \
+	sskBitmap kings = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing); \
+	sskBitmap checkers = sskBitmapWith##Opponent##AttackersToInPosition(position, sskFirstOneIndex(kings & position->colors[(us)]), sskBitmapForOccupancyInPosition(position)); \
+	\
+	/* Skip King if required. */ \
+	return shouldIncludeKing ? checkers : (checkers & ~kings); \
+} \
+\
+static kBool _sskCan##Side##KingEscape(const sskPosition * position) { \
+	sskBitmap king = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & position->colors[(us)]; \
+	\
+	/* The king is lifted from the occupancy so that sliders checking it also cover */ \
+	/* the squares behind it. Defended pieces are part of the attacked set. */ \
+	sskBitmap attackedSquares = sskBitmapWithSquaresAttackedBy##Opponent##InPosition(position, sskBitmapForOccupancyInPosition(position) & ~king); \
+	\
+	return (sskBitmapWithKingSetAttacks(king) & ~position->colors[(us)] & ~attackedSquares) ? kTrue : kFalse; \
+} \
+\
+static kBool _sskIs##Side##SquarePinned(const sskPosition * position, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessSquare * pinCausingPieceSquare) { \
+	sskBitmap between = sskBitmapWithSquaresBetween(behindSquare, pinnedSquare), beyondPinned; \
+	sskBitmap occupied = sskBitmapForOccupancyInPosition(position) | SSK_BITMAP_SET_SQUARE_IDX(behindSquare); \
+	sskBitmap queens = sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen); \
+	\
+	/* Not on a common rank, file or diagonal, or a piece stands between: no pin! */ \
+	if (sskBitmapWithLine(behindSquare, pinnedSquare) == SSK_EMPTY_BITMAP || (between & occupied)) return kFalse; \
+	\
+	/* Attacks from the pinned square with behindSquare as a blocker, so that on the line only */ \
+	/* the other side remains, up to the first piece there. Rook attacks never leave a diagonal */ \
+	/* and bishop attacks never leave a rank or file, so both kinds can be tested at once. */ \
+	beyondPinned = ((sskBitmapWithRookAttacks(pinnedSquare, occupied) & (sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) | queens)) | \
+					(sskBitmapWithBishopAttacks(pinnedSquare, occupied) & (sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) | queens))) & \
+				   position->colors[(them)] & sskBitmapWithLine(behindSquare, pinnedSquare) & ~between & SSK_BITMAP_UNSET_SQUARE_IDX(behindSquare); \
+	\
+	if (beyondPinned == SSK_EMPTY_BITMAP) return kFalse; \
+	\
+	if (pinCausingPieceSquare != NULL) *pinCausingPieceSquare = sskFirstOneIndex(beyondPinned); \
+	return kTrue; \
+}
+
+_SSK_DEFINE_SIDE_STATUS_KERNELS(White, Black, sskChessColorWhite, sskChessColorBlack)
+_SSK_DEFINE_SIDE_STATUS_KERNELS(Black, White, sskChessColorBlack, sskChessColorWhite)
+
+/**
+ *	A move recorded by the replay pass of sskSemanticAnalyzeInParallel(), with what the annotation
+ *	pass needs to fill its king status and placements on any thread.
+ */
+typedef struct _sskReplayedPly {
+	sskPosition			positionBeforeMove;			/** Position the move was played in. */
+	sskPosition			positionAfterMove;			/** Position after the move, if isComplete. */
+	sskMove *			move;						/** The move. */
+	sskChessSquare		lexedFromSquare;			/** fromSquare as the lexer left it, verification fills it. */
+	sskChessSquare		lexedToSquare;				/** toSquare as the lexer left it, castling verification fills it. */
+	char				castlingStatusAfterMove[5];	/** Castling status the next move starts with. */
+	sskChessSquare		enPassantTargetAfterMove;	/** En passant target the next move starts with. */
+	kBool				shouldUpdateSelfKingStatus;	/** No earlier move fills the move's own king status. */
+	kBool				isComplete;					/** The move was played, kFalse for the move the replay stopped at. */
+} sskReplayedPly;
+
+/** Index of a castling type in the xFEN castling status and bit of it in sskCastlingRights. */
+static int _sskCastlingSlot(sskCastlingType castlingType) {
+	switch (castlingType) {
+		case sskCastlingTypeWKSide: return 0;
+		case sskCastlingTypeWQSide: return 1;
+		case sskCastlingTypeBKSide: return 2;
+		case sskCastlingTypeBQSide: return 3;
+		default: return -1;
+	}
+}
+
+/**
+ *	Fills the king and rook squares of a castling type. The king is wherever it stands on its back
+ *	rank and the rook on the file of the castling status, so any Chess960 setup works. Returns
+ *	kFalse if the type is no castling or the right was lost.
+ */
+static kBool _sskFillCastlingSquares(const sskPosition * position, const char castlingStatus[5], sskCastlingType castlingType, sskChessSquare * kingSquare, sskChessSquare * kingToSquare, sskChessSquare * rookSquare, sskChessSquare * rookToSquare) {
+	int slot = _sskCastlingSlot(castlingType);
+	sskChessColor color = (slot < 2) ? sskChessColorWhite : sskChessColorBlack;
+	sskBitmap backRank = sskBitmapWithRankMask((color == sskChessColorWhite) ? 0 : 7);
+	sskBitmap king = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & position->colors[color] & backRank;
+	
+	if (slot < 0 || castlingStatus[slot] == '-' || king == SSK_EMPTY_BITMAP) return kFalse;
+	
+	*kingSquare = sskFirstOneIndex(king);
+	*rookSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(SSK_CHAR_2_FILE(tolower(castlingStatus[slot])), SSK_GET_RANK_IDX(*kingSquare));
+	*kingToSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_IDX((slot & 1) ? 2 : 6, SSK_GET_RANK_IDX(*kingSquare));
+	*rookToSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_IDX((slot & 1) ? 3 : 5, SSK_GET_RANK_IDX(*kingSquare));
+	return kTrue;
+}
+
+/** Castling needs the rook at home and every square of both paths empty, save for the two pieces. */
+static kBool _sskIsCastlingPathClear(const sskPosition * position, sskChessColor color, sskChessSquare kingSquare, sskChessSquare kingToSquare, sskChessSquare rookSquare, sskChessSquare rookToSquare) {
+	if (!(sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) & position->colors[color] & SSK_BITMAP_SET_SQUARE_IDX(rookSquare))) return kFalse;
+	
+	return (sskBitmapWithCastlingEmptySquares(kingSquare, kingToSquare, rookSquare, rookToSquare) & sskBitmapForOccupancyInPosition(position)) ? kFalse : kTrue;
+}
 
 sskSemanticAnalyzerError sskSemanticAnalyze(sskMoveList moveList, char * startingPosition, int * ambiguousHalfmoveNumber) {
-	// Move List is NULL.
-	if (moveList == NULL) { return sskSemanticAnalyzerErrorProvidedMoveListEmpty; }
+	return sskSemanticAnalyzeWithOptions(moveList, startingPosition, sskSemanticAnalyzerOptionNone, ambiguousHalfmoveNumber);
+}
+
+sskSemanticAnalyzerError sskSemanticAnalyzeWithOptions(sskMoveList moveList, char * startingPosition, sskSemanticAnalyzerOptions options, int * ambiguousHalfmoveNumber) {
+	// A context for this game only, its cache is never hit.
+	sskAnalyzerContext context;
+	sskInitAnalyzerContext(&context);
 	
-	// Starting FEN not specified
-	if (startingPosition == NULL || strlen(startingPosition) == 0) {
-		return sskSemanticAnalyzerErrorFirstPositionNotSpecified;
+	if (sskSemanticAnalyzeInContext(&context, moveList, startingPosition, options) == sskSemanticAnalyzerErrorAmbiguousMove && ambiguousHalfmoveNumber != NULL) {
+		*ambiguousHalfmoveNumber = context.ambiguousHalfmoveNumber;
+	}
+	return context.error;
+}
+
+#pragma mark - Analyzer context functions
+
+void sskInitAnalyzerContext(sskAnalyzerContext * context) {
+	sskInitBitboards();
+	
+	context->numStartPositions = 0;
+	context->nextStartPosition = 0;
+	context->lastStartPosition = 0;
+	sskResetAnalyzerContext(context);
+}
+
+void sskResetAnalyzerContext(sskAnalyzerContext * context) {
+	context->error = sskSemanticAnalyzerErrorNone;
+	context->ambiguousHalfmoveNumber = -1;
+}
+
+/** Returns the cache entry of a start position, parsing it into a free or the oldest entry on a miss. */
+static const sskStartPositionCacheEntry * _sskStartPositionInContext(sskAnalyzerContext * context, const char * startingPosition) {
+	size_t length = strcspn(startingPosition, " ");
+	kBool isCacheable = (length > 0 && length <= SSK_MAX_PIECE_PLACEMENT_LENGTH) ? kTrue : kFalse;
+	sskStartPositionCacheEntry * entry;
+	sskChessPiece offsetPosition[64];
+	unsigned short i, slot;
+	
+	// The last hit is tried first, batches mostly start from the same position.
+	if (isCacheable) {
+		for (i = 0; i < context->numStartPositions; i++) {
+			slot = (context->lastStartPosition + i) % context->numStartPositions;
+			entry = &context->startPositions[slot];
+			if (strncmp(entry->piecePlacement, startingPosition, length) == 0 && entry->piecePlacement[length] == '\0') {
+				context->lastStartPosition = slot;
+				return entry;
+			}
+		}
+	}
+	
+	if (context->numStartPositions < SSK_ANALYZER_CACHE_SIZE) {
+		slot = context->numStartPositions++;
+	} else {
+		slot = context->nextStartPosition;
+		context->nextStartPosition = (slot + 1) % SSK_ANALYZER_CACHE_SIZE;
+	}
+	context->lastStartPosition = slot;
+	entry = &context->startPositions[slot];
+	
+	sskFillOffsetPositionWithxFEN(offsetPosition, startingPosition);
+	sskOffsetPositionToPosition(offsetPosition, &entry->position);
+	entry->piecesKey = sskZobristKeyForPiecesInPosition(&entry->position);
+	entry->materialKey = sskMaterialKeyForPosition(&entry->position);
+	
+	// A placement too long for the key is parsed anyway, with an empty key that never matches.
+	if (isCacheable) {
+		memcpy(entry->piecePlacement, startingPosition, length);
+		entry->piecePlacement[length] = '\0';
+	} else {
+		entry->piecePlacement[0] = '\0';
 	}
 	
-	// Bitboard Position for calculating piece movements
-	sskBitboardPosition * curBitPos = sskxFEN2BitboardPosition(startingPosition), * temp = NULL;
+	return entry;
+}
+
+/** Sets up a game state at a parsed start position, the first move carries its own status. */
+static void _sskInitGameStateWithPosition(sskGameState * gameState, const sskPosition * position, sskZobristKey piecesKey, sskMaterialKey materialKey, sskSemanticAnalyzerOptions options) {
+	gameState->position = *position;
+	gameState->piecesKey = piecesKey;
+	gameState->materialKey = materialKey;
+	gameState->materialClass = sskMaterialClassForKey(materialKey);
+	
+	gameState->sideToMove = sskChessColorWhite;
+	gameState->halfmove = 0;
+	strcpy(gameState->castlingStatus, "----");
+	gameState->enPassantTarget = 0;
+	gameState->pawnHalfMoves = 0;
+	gameState->kingStatus = sskKingStatusNone;
+	gameState->didUpdateKingStatus = kFalse;
+	gameState->hasMoveStatus = kFalse;
+	
+	gameState->castlingRights = sskCastlingTypeNone;
+	gameState->shouldLoadCastlingRights = kTrue;
+	
+	gameState->historyTop = 0;
+	gameState->reversiblePlies = 0;
+	gameState->shouldSeedKeyHistory = kTrue;
+	gameState->isDrawnByRule = kFalse;
+	
+	gameState->options = options;
+	gameState->moveList = NULL;
+	gameState->lastMove = NULL;
+	gameState->error = sskSemanticAnalyzerErrorNone;
+	gameState->ambiguousHalfmoveNumber = -1;
+}
+
+/**
+ *	Analyses moves from a game state and leaves it after the last one played, the first error stops.
+ *	With replayedPlies the positions around each move are recorded instead of computing the king
+ *	status and placements, which the annotation pass then fills from them.
+ */
+static sskSemanticAnalyzerError _sskAnalyzeMovesInGameState(sskGameState * gameState, sskMove * firstMove, sskReplayedPly * replayedPlies, unsigned int * numReplayedPlies) {
+	sskSemanticAnalyzerError error = sskSemanticAnalyzerErrorNone;
+	sskSemanticAnalyzerOptions options = gameState->options;
+	sskReplayedPly * replayedPly = NULL;
+	
+	// Compact position, bitmaps for calculating piece movements and a mailbox for piece lookups.
+	// It is worked on in a local copy and stored back in the game state after the moves.
+	sskPosition curPos = gameState->position;
+	
+	// Zobrist key of the pieces, updated with the squares each move changes.
+	sskZobristKey piecesKey = gameState->piecesKey;
+	sskUndoRecord undoRecord;
+	
+	// Piece counts and their classification, which only change on captures and promotions.
+	sskMaterialKey materialKey = gameState->materialKey, materialKeyDelta;
+	sskMaterialClass materialClass = gameState->materialClass;
+	
+	// Castling rights with the rook files they were granted for and the rights each square keeps.
+	sskCastlingRights castlingRights = gameState->castlingRights, * castlingRightsUpdateMasks = gameState->castlingRightsUpdateMasks;
+	char * castlingFiles = gameState->castlingFiles;
+	kBool shouldLoadCastlingRights = gameState->shouldLoadCastlingRights;
 	
-	// Offset Board for easy lookup of piece positions.
-	sskOffsetPosition curOffsetPos = sskxFENtoOffsetPosition(startingPosition);
+	// Castling, en passant and halfmove clock state after the current move.
+	char nextCastlingStatus[5];
+	sskChessSquare nextEnPassantTarget;
+	unsigned short nextPawnHalfMoves;
+	
+	// State of a side whose legal moves are looked for, checkmate and stalemate leave none.
+	sskPositionState sideState;
+	kBool opponentHasLegalMove = kTrue;
+	int numChecks;
+	
+	// Outputs to compute, checkmate and stalemate need the checks anyway.
+	kBool shouldComputeGameEnd = (options & sskSemanticAnalyzerOptionSkipGameEnd) ? kFalse : kTrue;
+	kBool shouldComputeChecks = (replayedPlies == NULL && (shouldComputeGameEnd || !(options & sskSemanticAnalyzerOptionSkipChecks))) ? kTrue : kFalse;
+	kBool shouldFillPlacements = (replayedPlies == NULL && !(options & sskSemanticAnalyzerOptionSkipPlacements)) ? kTrue : kFalse;
+	
+	// Position keys since the last pawn move or capture, for repetition detection. A ring, the
+	// oldest keys are only overwritten past the 150 plies of the 75-move rule.
+	sskZobristKey * keyHistory = gameState->keyHistory;
+	unsigned int historyTop = gameState->historyTop, reversiblePlies = gameState->reversiblePlies, i;
+	kBool shouldSeedKeyHistory = gameState->shouldSeedKeyHistory, isDrawnByRule = gameState->isDrawnByRule;
 		
 	// The list traverser.
 	sskMove * trav = NULL;
-	trav = moveList;
+	trav = firstMove;
 	kBool ambiguity = kFalse;
 	
+	// The first move starts with the status the last analysed one left.
+	if (gameState->hasMoveStatus) {
+		strcpy(trav->castlingStatus, gameState->castlingStatus);
+		if (gameState->enPassantTarget != 0) trav->enPassantTarget = gameState->enPassantTarget;
+		trav->pawnHalfMoves = gameState->pawnHalfMoves;
+		
+		if (gameState->didUpdateKingStatus) {
+			trav->selfKingStatus = gameState->kingStatus;
+			trav->didUpdateSelfKingStatus = kTrue;
+		}
+	}
+	
 	while (trav != NULL) {
         // NULL move condition
 		if (trav->pieceMoved == sskChessPieceNone) {
+			// Repetitions never span a null move, the history restarts at the next move. So do
+			// the castling rights, from the status the next move carries.
+			shouldSeedKeyHistory = kTrue;
+			shouldLoadCastlingRights = kTrue;
+			
+			gameState->sideToMove = !gameState->sideToMove;
+			gameState->halfmove = trav->halfmove + 1;
+			gameState->hasMoveStatus = kFalse;
 			trav = trav->next;
 			continue;
 		}
+		
+#if SSK_COUNT_ALLOCATIONS
+		unsigned long allocationsBeforePly = sskHeapAllocationCount;
+#endif
+		
+		// The move's own king status is wanted only at the start and after a null move.
+		if (replayedPlies != NULL) {
+			replayedPly = &replayedPlies[(*numReplayedPlies)++];
+			replayedPly->move = trav;
+			replayedPly->lexedFromSquare = trav->fromSquare;
+			replayedPly->lexedToSquare = trav->toSquare;
+			replayedPly->positionBeforeMove = curPos;
+			replayedPly->shouldUpdateSelfKingStatus = (!trav->didUpdateSelfKingStatus && !gameState->hasMoveStatus) ? kTrue : kFalse;
+			replayedPly->isComplete = kFalse;
+		}
         
         /*------------ Update self king status before the move -----------*/
-		if (!trav->didUpdateSelfKingStatus) {
+		if (!trav->didUpdateSelfKingStatus && shouldComputeChecks) {
 			// Check for checks
-			int numChecks = sskIsKingUnderCheck(*curBitPos, SSK_GET_PIECE_COLOR(trav->pieceMoved), kFalse, NULL);
+			numChecks = sskIsKingUnderCheckInPosition(&curPos, SSK_GET_PIECE_COLOR(trav->pieceMoved), kFalse, NULL);
             if (numChecks > 0) {
                 trav->selfKingStatus = sskKingStatusCheck;
 			}
             
             // Check for checkmate or stalemate
-			if (trav->selfKingStatus == sskKingStatusCheck) {
-				
-				if (sskIsKingUnderCheckMate(*curBitPos, SSK_GET_PIECE_COLOR(trav->pieceMoved), numChecks, trav->enPassantTarget)) {
-					trav->selfKingStatus = sskKingStatusCheckMate;
-				}
+			if (shouldComputeGameEnd) {
+				sideState.sideToMove = SSK_GET_PIECE_COLOR(trav->pieceMoved);
+				strcpy(sideState.castlingStatus, trav->castlingStatus);
+				sideState.enPassantTarget = trav->enPassantTarget;
 				
-			} else {
-				if (sskIsKingUnderStalemate(*curBitPos, SSK_GET_PIECE_COLOR(trav->pieceMoved), trav->enPassantTarget)) {
-					trav->selfKingStatus = sskKingStatusStalemate;
+				if (!sskHasLegalMove(&curPos, &sideState)) {
+					trav->selfKingStatus = (trav->selfKingStatus == sskKingStatusCheck) ? sskKingStatusCheckMate : sskKingStatusStalemate;
 				}
 			}
             
@@ -61,57 +343,62 @@ sskSemanticAnalyzerError sskSemanticAnalyze(sskMoveList moveList, char * startin
         }
 				
 		/*------ Fill move's piece placement string before the move -----*/
-		sskFillPiecePlacementWithOffsetPosition(trav->piecePlacementBeforeMove, curOffsetPos);
+		if (shouldFillPlacements) {
+			sskFillPiecePlacementWithPosition(trav->piecePlacementBeforeMove, &curPos);
+		}
+		
+		if (shouldComputeGameEnd) {
+			trav->positionKeyBeforeMove = piecesKey ^ sskZobristKeyForStateInPosition(&curPos, SSK_GET_PIECE_COLOR(trav->pieceMoved), trav->castlingStatus, trav->enPassantTarget);
+			
+			if (shouldSeedKeyHistory) {
+				historyTop = 0;
+				reversiblePlies = 0;
+				keyHistory[historyTop] = trav->positionKeyBeforeMove;
+				shouldSeedKeyHistory = kFalse;
+			}
+		}
 		
 		/*------------- Before Proceeding to prcess the move, abort if the game has already ended -------------*/
 		if (trav->selfKingStatus == sskKingStatusCheckMate || trav->selfKingStatus == sskKingStatusStalemate) {
-			return sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
+			error = sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
+			break;
 		}
 		
-		// Insufficient pieces condition - Only 2 Kings
-		if (sskCountBits(curBitPos->occupied) == 2) {
-			return sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
+		// Fivefold repetition or the 75-move rule drew the game automatically.
+		if (isDrawnByRule && (options & sskSemanticAnalyzerOptionRejectMovesAfterAutomaticDraw)) {
+			error = sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
+			break;
 		}
 		
-		// Insufficient pieces condition - 2 Kings and one Bishop or Knight
-		if (sskCountBits(curBitPos->occupied) == 3) {
-			if ((sskCountBits(curBitPos->wBishop) == 1) ||
-				(sskCountBits(curBitPos->bBishop) == 1) ||
-				(sskCountBits(curBitPos->wKnight) == 1) ||
-				(sskCountBits(curBitPos->bKnight) == 1)
-				) {
-				return sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
-			}
+		// Insufficient material, neither side can ever mate.
+		if (shouldComputeGameEnd && SSK_IS_MATERIAL_CLASS_DEAD(materialClass)) {
+			error = sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
+			break;
 		}
 		
 		/*--------- Verify if the move is pseudo-legal. ---------*/
-		if (sskFillFromSquare(*curBitPos, curOffsetPos, trav, &ambiguity) == kFalse) {
-			return sskSemanticAnalyzerErrorIllegalMove;
+		if (sskFillFromSquareInPosition(&curPos, trav, &ambiguity) == kFalse) {
+			error = sskSemanticAnalyzerErrorIllegalMove;
+			break;
 		}
 		
 		if (ambiguity) {
-			if (ambiguousHalfmoveNumber != NULL) {
-				*ambiguousHalfmoveNumber = trav->halfmove;
-			}
-			return sskSemanticAnalyzerErrorAmbiguousMove;
+			gameState->ambiguousHalfmoveNumber = trav->halfmove;
+			error = sskSemanticAnalyzerErrorAmbiguousMove;
+			break;
 		}
 		
 		/*------------ Verify if the move is legal -------------*/
-		temp = sskCheckLegal(*curBitPos, trav, kTrue);
-        if (temp == NULL) {
-            return sskSemanticAnalyzerErrorIllegalMove;
+		if (!sskCheckLegalInPosition(&curPos, trav, kTrue, NULL)) {
+            error = sskSemanticAnalyzerErrorIllegalMove;
+            break;
         }
         
-        // use the updated bitboard from checkLegal() to update current bitboard.
-        // NOTE: At this point we don't update the offset board yet!
-        free(curBitPos);
-        curBitPos = temp;
-        temp = NULL;
-				
-        /*------------ Update current move's status with old offset board -----------*/
-        // capture
-        if ((curOffsetPos[trav->toSquare] != sskChessPieceNone)) {
-            trav->capturedPiece = SSK_GET_GENERIC_PIECE_CODE(curOffsetPos[trav->toSquare]);
+        /*------------ Update current move's status with the position before the move -----------*/
+        // capture, a Chess960 castling king may land on its own rook
+        if (trav->castlingType == sskCastlingTypeNone && curPos.mailbox[trav->toSquare] != sskChessPieceNone &&
+            SSK_GET_PIECE_COLOR(curPos.mailbox[trav->toSquare]) != SSK_GET_PIECE_COLOR(trav->pieceMoved)) {
+            trav->capturedPiece = SSK_GET_GENERIC_PIECE_CODE(curPos.mailbox[trav->toSquare]);
         }
         
         // en-passant
@@ -119,953 +406,1085 @@ sskSemanticAnalyzerError sskSemanticAnalyze(sskMoveList moveList, char * startin
             trav->capturedPiece = (sskChessPiecePawn) | (!SSK_GET_PIECE_COLOR(trav->pieceMoved) << 3);
         }
         
-        /*-------------------- Update next move's status (if any) -------------------*/
-        if (trav->next != NULL) {
-            /*---------------- Adjust castling options for next move ---------------*/
-            strcpy(trav->next->castlingStatus, trav->castlingStatus);	// Copy the castlingStatus string
-			
-			// King was castled in the current move
-			if (trav->castlingType == sskCastlingTypeWKSide) trav->next->castlingStatus[0] = '-';
-			if (trav->castlingType == sskCastlingTypeWQSide) trav->next->castlingStatus[1] = '-';
-            if (trav->castlingType == sskCastlingTypeBKSide) trav->next->castlingStatus[2] = '-';
-            if (trav->castlingType == sskCastlingTypeBQSide) trav->next->castlingStatus[3] = '-';
-			
-			// King was moved in the current move
-			if (trav->pieceMoved == sskChessPieceWKing) {
-				trav->next->castlingStatus[0] = trav->next->castlingStatus[1] = '-';
-			}
-            if (trav->pieceMoved == sskChessPieceBKing) {
-                trav->next->castlingStatus[2] = trav->next->castlingStatus[3] = '-';
+        /*------ Castling options and enpassant target after the move ------*/
+        if (shouldLoadCastlingRights) {
+            castlingRights = sskCastlingRightsFromStatus(trav->castlingStatus);
+            sskFillCastlingRightsUpdateMasks(&curPos, trav->castlingStatus, castlingRightsUpdateMasks);
+            strcpy(castlingFiles, trav->castlingStatus);
+            shouldLoadCastlingRights = kFalse;
+        }
+        
+        // A move from or to a king or castling rook home square, castling included, drops its rights.
+        castlingRights &= castlingRightsUpdateMasks[trav->fromSquare] & castlingRightsUpdateMasks[trav->toSquare];
+        for (i = 0; i < 4; i++) {
+            nextCastlingStatus[i] = (castlingRights & (1 << i)) ? castlingFiles[i] : '-';
+        }
+        nextCastlingStatus[4] = '\0';
+        nextEnPassantTarget = 0;
+        
+        // Set enpassant target for next move if the current pawn move was a double move
+        if (SSK_GET_GENERIC_PIECE_CODE(trav->pieceMoved) == sskChessPiecePawn) {
+            // Look for a double move - White Side
+			if ((SSK_GET_RANK_IDX(trav->toSquare) - SSK_GET_RANK_IDX(trav->fromSquare)) == 2) {
+                // Mark the previous square as enpassant target
+                nextEnPassantTarget = trav->toSquare - 8;
             }
 			
-			// The rook was moved in the current move
-			if ((trav->pieceMoved == sskChessPieceWRook) && (trav->castlingStatus[0] != '-')) {
-                if ((SSK_CHAR_2_FILE(tolower(trav->castlingStatus[0])) == SSK_GET_FILE_IDX(trav->fromSquare)) && (SSK_GET_RANK_IDX(trav->fromSquare) == 0)) {
-                    trav->next->castlingStatus[0] = '-';
-                }
+			// Look for a double move - Black Side
+            if ((SSK_GET_RANK_IDX(trav->toSquare) - SSK_GET_RANK_IDX(trav->fromSquare)) == -2) {
+                // Mark the previous square as enpassant target
+                nextEnPassantTarget = trav->toSquare + 8;
             }
-            if ((trav->pieceMoved == sskChessPieceWRook) && (trav->castlingStatus[1] != '-')) {
-                if ((SSK_CHAR_2_FILE(tolower(trav->castlingStatus[1])) == SSK_GET_FILE_IDX(trav->fromSquare)) && (SSK_GET_RANK_IDX(trav->fromSquare) == 0)) {
-                    trav->next->castlingStatus[1] = '-';
-                }
-            }
-            if ((trav->pieceMoved == sskChessPieceBRook) && (trav->castlingStatus[2] != '-')) {
-                if ((SSK_CHAR_2_FILE(tolower(trav->castlingStatus[2])) == SSK_GET_FILE_IDX(trav->fromSquare)) && (SSK_GET_RANK_IDX(trav->fromSquare) == 7)) {
-                    trav->next->castlingStatus[2] = '-';
-                }
-            }
-            if ((trav->pieceMoved == sskChessPieceBRook) && (trav->castlingStatus[3] != '-')) {
-                if ((SSK_CHAR_2_FILE(tolower(trav->castlingStatus[3])) == SSK_GET_FILE_IDX(trav->fromSquare)) && (SSK_GET_RANK_IDX(trav->fromSquare) == 7)) {
-                    trav->next->castlingStatus[3] = '-';
-                }
-            }
-            
-            // Set enpassant target for next move if the current pawn move was a double move
-            if (SSK_GET_GENERIC_PIECE_CODE(trav->pieceMoved) == sskChessPiecePawn) {
-                // Look for a double move - White Side
-				if ((SSK_GET_RANK_IDX(trav->toSquare) - SSK_GET_RANK_IDX(trav->fromSquare)) == 2) {
-                    // Mark the previous square as enpassant target
-                    trav->next->enPassantTarget = trav->toSquare - 8;
-                }
-				
-				// Look for a double move - Black Side
-                if ((SSK_GET_RANK_IDX(trav->toSquare) - SSK_GET_RANK_IDX(trav->fromSquare)) == -2) {
-                    // Mark the previous square as enpassant target
-                    trav->next->enPassantTarget = trav->toSquare + 8;
-                }
+        }
+        
+        // Update the halfmove clock (pawn plys) - moves since last pawn move/capture.
+        if (SSK_GET_GENERIC_PIECE_CODE(trav->pieceMoved) == sskChessPiecePawn || trav->capturedPiece != sskChessPieceNone) {
+            nextPawnHalfMoves = 0;
+        } else {
+            nextPawnHalfMoves = trav->pawnHalfMoves + 1;
+        }
+        
+        /*-------------------- Update next move's status (if any) -------------------*/
+        if (trav->next != NULL) {
+            strcpy(trav->next->castlingStatus, nextCastlingStatus);
+            if (nextEnPassantTarget != 0) trav->next->enPassantTarget = nextEnPassantTarget;
+            trav->next->pawnHalfMoves = nextPawnHalfMoves;
+        }
+		
+        // Play the legal move on the current position and update the position key.
+        sskMakeMoveInPosition(&curPos, trav, &undoRecord);
+        if (shouldComputeGameEnd) {
+            piecesKey ^= sskZobristKeyForMove(&undoRecord);
+            materialKeyDelta = sskMaterialKeyForMove(&undoRecord);
+            if (materialKeyDelta != 0) {
+                materialKey += materialKeyDelta;
+                materialClass = sskMaterialClassForKey(materialKey);
             }
-			
-			// Update the halfmove clock (pawn plys) - moves since last pawn move/capture for the next move.
-			if (SSK_GET_GENERIC_PIECE_CODE(trav->pieceMoved) == sskChessPiecePawn || trav->capturedPiece != sskChessPieceNone) {
-				trav->next->pawnHalfMoves = 0;
-			} else {
-				trav->next->pawnHalfMoves = trav->pawnHalfMoves + 1;
-			}
+            trav->materialKeyAfterMove = materialKey;
+            trav->endgameClassAfterMove = SSK_GET_ENDGAME_CLASS(materialClass);
+            trav->positionKeyAfterMove = piecesKey ^ sskZobristKeyForStateInPosition(&curPos, !SSK_GET_PIECE_COLOR(trav->pieceMoved), nextCastlingStatus, nextEnPassantTarget);
         }
-		       
-        // Udpate the offset position with the new bitboard position from checkLegal()
-        free(curOffsetPos);
-		curOffsetPos = sskBitboardPositionToOffsetPosition(*curBitPos);
 						
 		/*------------ Update the opponent king status after the move -----------*/
-		// Check for check
-		int numChecks = sskIsKingUnderCheck(*curBitPos, !SSK_GET_PIECE_COLOR(trav->pieceMoved), kFalse, NULL);
-		if (numChecks > 0) {
-            trav->opponentKingStatus = sskKingStatusCheck;
-            trav->didUpdateOpponentKingStatus = kTrue;
+		if (shouldComputeChecks) {
+			// Check for check
+			numChecks = sskIsKingUnderCheckInPosition(&curPos, !SSK_GET_PIECE_COLOR(trav->pieceMoved), kFalse, NULL);
+		
+			// Checkmate or stalemate, the opponent has no legal move.
+			if (shouldComputeGameEnd) {
+				sideState.sideToMove = !SSK_GET_PIECE_COLOR(trav->pieceMoved);
+				strcpy(sideState.castlingStatus, nextCastlingStatus);
+				sideState.enPassantTarget = nextEnPassantTarget;
+				opponentHasLegalMove = sskHasLegalMove(&curPos, &sideState);
+			}
+		
+			if (numChecks > 0) {
+				trav->opponentKingStatus = sskKingStatusCheck;
+				trav->didUpdateOpponentKingStatus = kTrue;
             
-            if (trav->next != NULL) {
-                trav->next->selfKingStatus = sskKingStatusCheck;
-                trav->next->didUpdateSelfKingStatus = kTrue;
-            }
+				if (trav->next != NULL) {
+					trav->next->selfKingStatus = sskKingStatusCheck;
+					trav->next->didUpdateSelfKingStatus = kTrue;
+				}
 			
-			// Check for Checkmate
-			if (sskIsKingUnderCheckMate(*curBitPos, !SSK_GET_PIECE_COLOR(trav->pieceMoved), numChecks, (trav->next != NULL)?trav->next->enPassantTarget:-1)) {
-				trav->opponentKingStatus = sskKingStatusCheckMate;
-				trav->didUpdateOpponentKingStatus = kTrue;
+				// Check for Checkmate
+				if (!opponentHasLegalMove) {
+					trav->opponentKingStatus = sskKingStatusCheckMate;
+					trav->didUpdateOpponentKingStatus = kTrue;
 				
+					if (trav->next != NULL) {
+						trav->next->selfKingStatus = sskKingStatusCheckMate;
+						trav->next->didUpdateSelfKingStatus = kTrue;
+					}
+				}
+			} else if (!opponentHasLegalMove) {
+				trav->opponentKingStatus = sskKingStatusStalemate;
+				trav->didUpdateOpponentKingStatus = kTrue;
+			
 				if (trav->next != NULL) {
-					trav->next->selfKingStatus = sskKingStatusCheckMate;
+					trav->next->selfKingStatus = sskKingStatusStalemate;
+					trav->next->didUpdateSelfKingStatus = kTrue;
+				}
+			} else {
+				if (trav->next != NULL) {
+					trav->next->selfKingStatus = sskKingStatusNone;
 					trav->next->didUpdateSelfKingStatus = kTrue;
 				}
-			}
-        } else if (sskIsKingUnderStalemate(*curBitPos, !SSK_GET_PIECE_COLOR(trav->pieceMoved), (trav->next != NULL)?trav->next->enPassantTarget:-1)) {
-			trav->opponentKingStatus = sskKingStatusStalemate;
-			trav->didUpdateOpponentKingStatus = kTrue;
-			
-			if (trav->next != NULL) {
-				trav->next->selfKingStatus = sskKingStatusStalemate;
-				trav->next->didUpdateSelfKingStatus = kTrue;
-			}
-		} else {
-			if (trav->next != NULL) {
-				trav->next->selfKingStatus = sskKingStatusNone;
-				trav->next->didUpdateSelfKingStatus = kTrue;
 			}
 		}
-				
-		// Fill move's piece placement string after the move
-		sskFillPiecePlacementWithOffsetPosition(trav->piecePlacementAfterMove, curOffsetPos);
 		
-		trav = trav->next;
-	}
-	
-	free(curBitPos);
-	free(curOffsetPos);
+		/*------------ Repetition and move rule draws after the move -----------*/
+		if (shouldComputeGameEnd) {
+			reversiblePlies = (nextPawnHalfMoves == 0) ? 0 : reversiblePlies + 1;
+			historyTop = (historyTop + 1) & (SSK_KEY_HISTORY_SIZE - 1);
+			keyHistory[historyTop] = trav->positionKeyAfterMove;
 		
-	return 0;
-}
-
-kBool sskFillFromSquare(sskBitboardPosition bitboardPosition, sskOffsetPosition offsetPosition, sskMove * move, kBool * ambiguity) {
-	sskChessSquare fromSquare;
-	short reachablePieces;
-	sskChessSquare reachablePiecesSquaresArray[8], pinnerSquare;	// Maximum of 8 reachable pieces from 8 directions
-	kBool underPin;
-	sskBitmap singlePieceBitmap, attackMap;
-    int isCastlingOrEnpassantTarget;
-	*ambiguity = kFalse;
-    
-    // Initialize Variables
-    reachablePieces = 0;
-    sskChessColor color = SSK_GET_PIECE_COLOR(move->pieceMoved);
-    sskChessPiece pieceWithColor = move->pieceMoved;
-    isCastlingOrEnpassantTarget = -1;
-    
-    // Check for special conditions: Castling and Enpassant
-    if ((SSK_GET_GENERIC_PIECE_CODE(pieceWithColor) == sskChessPieceKing)) {
-        switch (move->castlingType) {
-            case sskCastlingTypeWKSide: {
-                if (move->castlingStatus[0] == '-') return kFalse; // Castling not possible
-                isCastlingOrEnpassantTarget = SSK_CHAR_2_FILE(tolower(move->castlingStatus[0]));
-                move->fromSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('e', '1');
-                move->toSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('g', '1');
-                break;
-            }
-                
-            case sskCastlingTypeWQSide: {
-                if (move->castlingStatus[1] == '-') return kFalse; // Castling not possible
-                isCastlingOrEnpassantTarget = SSK_CHAR_2_FILE(tolower(move->castlingStatus[1]));
-                move->fromSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('e', '1');
-                move->toSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('c', '1');
-                break;
-            }
-                
-            case sskCastlingTypeBKSide: {
-                if (move->castlingStatus[2] == '-') return kFalse; // Castling not possible
-                isCastlingOrEnpassantTarget = SSK_CHAR_2_FILE(tolower(move->castlingStatus[2]));
-                move->fromSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('e', '8');
-                move->toSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('g', '8');
-                break;
-            }
-                
-            case sskCastlingTypeBQSide: {
-                if (move->castlingStatus[3] == '-') return kFalse; // Castling not possible
-                isCastlingOrEnpassantTarget = SSK_CHAR_2_FILE(tolower(move->castlingStatus[3]));
-                move->fromSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('e', '8');
-                move->toSquare = SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('c', '8');
-                break;
-            }
-                
-            case sskCastlingTypeNone: {
-                isCastlingOrEnpassantTarget = -1;
-                break;
-            }
-        }
-    } else if (SSK_GET_GENERIC_PIECE_CODE(pieceWithColor) == sskChessPiecePawn) {
-        isCastlingOrEnpassantTarget = move->enPassantTarget;
-    }
-    
-    // Obtain bitmap for the piece moved
-    singlePieceBitmap = sskBitmapForPieceInBitboardPosition(bitboardPosition, move->pieceMoved);
-    // Check if such a piece exists on the board
-    if (singlePieceBitmap == SSK_EMPTY_BITMAP) return kFalse;
-    
-	/*------------ Reducing the search range -------------*/
-	switch (SSK_GET_GENERIC_PIECE_CODE(pieceWithColor)) {
-		case sskChessPiecePawn: {
-			// If the piece is a pawn, we can reduce our search
-			// to the pawns in file-1, file and file+1, and ranks
-			singlePieceBitmap = singlePieceBitmap & (
-				 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare) - 1)) |
-				 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare))) |
-				 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare) + 1))
-			 );
-			if (color == sskChessColorWhite) {
-				singlePieceBitmap = singlePieceBitmap & (
-				 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) - 1)) |
-				 ((SSK_GET_RANK_IDX(move->toSquare) == 3)?sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) - 2):SSK_EMPTY_BITMAP)
-				 );
+			// The same side is to move every other ply, no older position can come back after a
+			// pawn move or capture.
+			trav->positionRepetitions = 1;
+			for (i = 2; i <= reversiblePlies && i < SSK_KEY_HISTORY_SIZE; i += 2) {
+				if (keyHistory[(historyTop - i) & (SSK_KEY_HISTORY_SIZE - 1)] == trav->positionKeyAfterMove) trav->positionRepetitions++;
+			}
+		
+			// A checkmate on the last move stands over the move rules, stalemate already ended the game.
+			if (trav->positionRepetitions >= 5) {
+				trav->drawStatus = sskDrawStatusFivefoldRepetition;
+			} else if (nextPawnHalfMoves >= 150 && trav->opponentKingStatus != sskKingStatusCheckMate) {
+				trav->drawStatus = sskDrawStatusSeventyFiveMoveRule;
+			} else if (trav->positionRepetitions >= 3) {
+				trav->drawStatus = sskDrawStatusThreefoldRepetition;
+			} else if (nextPawnHalfMoves >= 100 && trav->opponentKingStatus != sskKingStatusCheckMate) {
+				trav->drawStatus = sskDrawStatusFiftyMoveRule;
 			} else {
-				singlePieceBitmap = singlePieceBitmap & (
-				 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) + 1)) |
-				 ((SSK_GET_RANK_IDX(move->toSquare) == 4)?sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) + 2):SSK_EMPTY_BITMAP)
-				);
+				trav->drawStatus = sskDrawStatusNone;
 			}
-			break;
+			isDrawnByRule = (trav->drawStatus == sskDrawStatusFivefoldRepetition || trav->drawStatus == sskDrawStatusSeventyFiveMoveRule);
 		}
 		
-		case sskChessPieceKnight: {
-			// If the piece is a knight, we can reduce our search
-			// to the 25 squares around toSquare
-			singlePieceBitmap = singlePieceBitmap & (
-			 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare) - 2)) |
-			 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare) - 1)) |
-			 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare) + 1)) |
-			 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare) + 2)) |
-			 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) - 2)) |
-			 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) - 1)) |
-			 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) + 1)) |
-			 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare) + 2))
-			 );
-			break;
+		// Fill move's piece placement string after the move
+		if (shouldFillPlacements) {
+			sskFillPiecePlacementWithPosition(trav->piecePlacementAfterMove, &curPos);
 		}
 		
-		case sskChessPieceRook: {
-			// If the piece is a rook, we can reduce our search
-			// to same file/rank as that of toSquare
-			singlePieceBitmap = singlePieceBitmap & (
-			 (sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->toSquare))) |
-			 (sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->toSquare)))
-			);
-			break;
-		}
-			
-		case sskChessPieceBishop: {
-			// If the piece is a rook, we can reduce our search
-			// to same file/rank as that of toSquare
-			singlePieceBitmap = singlePieceBitmap & (
-			 sskBitmapWithNorthWestDiagonal(move->toSquare) | sskBitmapWithSouthEastDiagonal(move->toSquare) | sskBitmapWithNorthEastDiagonal(move->toSquare) | sskBitmapWithSouthWestDiagonal(move->toSquare)
-			);
-			break;
+		if (replayedPly != NULL) {
+			replayedPly->positionAfterMove = curPos;
+			strcpy(replayedPly->castlingStatusAfterMove, nextCastlingStatus);
+			replayedPly->enPassantTargetAfterMove = nextEnPassantTarget;
+			replayedPly->isComplete = kTrue;
 		}
+		
+		// The status the next move starts with, kept for moves that come later.
+		gameState->sideToMove = !SSK_GET_PIECE_COLOR(trav->pieceMoved);
+		gameState->halfmove = trav->halfmove + 1;
+		strcpy(gameState->castlingStatus, nextCastlingStatus);
+		gameState->enPassantTarget = nextEnPassantTarget;
+		gameState->pawnHalfMoves = nextPawnHalfMoves;
+		gameState->kingStatus = trav->opponentKingStatus;
+		gameState->didUpdateKingStatus = shouldComputeChecks;
+		gameState->hasMoveStatus = kTrue;
+		
+#if SSK_COUNT_ALLOCATIONS
+		assert(sskHeapAllocationCount == allocationsBeforePly);	// A ply never touches the heap
+#endif
+		
+		trav = trav->next;
 	}
-	/*------------ Reducing the search range -------------*/
 	
-	// If the piece is a pawn, we can reduce our search
-	// to the pawns in file-1, file and file+1
-	
-    // Iterate to find all pieces of the given type and check if it can reach to
-    while (singlePieceBitmap) {
-        fromSquare = sskFirstOneIndex(singlePieceBitmap);
-        singlePieceBitmap = singlePieceBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
-        
-        if (sskIsSquareReachable(bitboardPosition, fromSquare, move->toSquare, isCastlingOrEnpassantTarget, &attackMap) == kTrue) {
-            // If piece is a king, we can skip checking for pins.
-            if (SSK_GET_GENERIC_PIECE_CODE(pieceWithColor) != sskChessPieceKing) {
-                underPin = sskIsSquarePinned(bitboardPosition, offsetPosition, fromSquare,
-                                    (color == sskChessColorWhite)?sskFirstOneIndex(bitboardPosition.wKing):sskFirstOneIndex(bitboardPosition.bKing),
-                                    color, &pinnerSquare);
-                // We count the piece on conditions:
-                //  1) It is not reachable.
-                //  2) It captures the pinnerPiece.
-                //  3) It maintains the pin.
-                if (!underPin) {
-                    reachablePiecesSquaresArray[reachablePieces++] = fromSquare;	// 1
-                } else if (underPin) {
-                    if (attackMap & SSK_BITMAP_SET_SQUARE_IDX(pinnerSquare)) {
-						reachablePiecesSquaresArray[reachablePieces++] = fromSquare; // 2
-					} else {
-						// 3 - Check if the pinner square can reach the king after move
-						sskOffsetPosition afterMovePos = sskCopyOffsetPosition(offsetPosition);
-						afterMovePos[fromSquare] = sskChessPieceNone;
-						afterMovePos[move->toSquare] = move->pieceMoved;
-						sskBitmap tempAttackMap;
-						sskBitboardPosition * tempBitboardPosition = sskOffsetPositionToBitboardPosition(afterMovePos);
-						if(!sskIsSquareReachable(*tempBitboardPosition, pinnerSquare, (color == sskChessColorWhite)?sskFirstOneIndex(bitboardPosition.wKing):sskFirstOneIndex(bitboardPosition.bKing),-1, &tempAttackMap)) {
-							reachablePiecesSquaresArray[reachablePieces++] = fromSquare;
-						}
-						free(tempBitboardPosition);
-						free(afterMovePos);
-					}
-                }
-            } else {
-                reachablePiecesSquaresArray[reachablePieces++] = fromSquare;
-            }
-        }
-    }
-    
-    if (reachablePieces == 0) return kFalse; // None of the pieces could reach the destination
-    else {
-        *ambiguity = sskCheckMoveAmbiguityAndFillFromSquare(offsetPosition, reachablePiecesSquaresArray, reachablePieces, move);
-    }
-    
-	return kTrue;
+	// Everything else the next moves continue from.
+	gameState->position = curPos;
+	gameState->piecesKey = piecesKey;
+	gameState->materialKey = materialKey;
+	gameState->materialClass = materialClass;
+	gameState->castlingRights = castlingRights;
+	gameState->shouldLoadCastlingRights = shouldLoadCastlingRights;
+	gameState->historyTop = historyTop;
+	gameState->reversiblePlies = reversiblePlies;
+	gameState->shouldSeedKeyHistory = shouldSeedKeyHistory;
+	gameState->isDrawnByRule = isDrawnByRule;
+		
+	return error;
 }
 
-sskBitboardPosition * sskCheckLegal(sskBitboardPosition bitboardPosition, sskMove * move, kBool moveWasPseudoLegalChecked) {
-    sskOffsetPosition offsetPosition = sskBitboardPositionToOffsetPosition(bitboardPosition);
-    sskBitboardPosition * verificationBitboard = NULL;
-    unsigned short numChecks = 0;
-	
-	if (!moveWasPseudoLegalChecked) {
-		sskBitmap attackMap;
-		kBool underPin, pieceCanReach = kFalse;
-		sskChessSquare pinnerSquare;
-		
-		if (sskIsSquareReachable(bitboardPosition, move->fromSquare, move->toSquare, (move->castlingType != sskCastlingTypeNone)?move->castlingType:(move->enPassantTarget != 0)?move->enPassantTarget:-1, &attackMap) == kTrue) {
-            // If piece is a king, we can skip checking for pins.
-            if (SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved) != sskChessPieceKing) {
-                underPin = sskIsSquarePinned(bitboardPosition, offsetPosition, move->fromSquare,
-											 (SSK_GET_PIECE_COLOR(move->pieceMoved) == sskChessColorWhite)?sskFirstOneIndex(bitboardPosition.wKing):sskFirstOneIndex(bitboardPosition.bKing),
-											 SSK_GET_PIECE_COLOR(move->pieceMoved), &pinnerSquare);
-                // We count the piece on conditions:
-                //  1) It is not reachable.
-                //  2) It captures the pinnerPiece.
-                //  3) It maintains the pin.
-                if (!underPin) {
-                    pieceCanReach = kTrue;
-                } else {
-					if (attackMap & SSK_BITMAP_SET_SQUARE_IDX(pinnerSquare)) {
-						pieceCanReach = kTrue; // 2
-					} else {
-						// 3 - Check if the pinner square can reach the king after move
-						sskOffsetPosition afterMovePos = sskCopyOffsetPosition(offsetPosition);
-						afterMovePos[move->fromSquare] = sskChessPieceNone;
-						afterMovePos[move->toSquare] = move->pieceMoved;
-						sskBitmap tempAttackMap;
-						if(!sskIsSquareReachable(*sskOffsetPositionToBitboardPosition(afterMovePos), pinnerSquare, (SSK_GET_PIECE_COLOR(move->pieceMoved) == sskChessColorWhite)?sskFirstOneIndex(bitboardPosition.wKing):sskFirstOneIndex(bitboardPosition.bKing),-1, &tempAttackMap)) {
-							pieceCanReach = kTrue;
-							free(afterMovePos);
-						}
-					}
-				}
-            } else {
-				pieceCanReach = kTrue;
-            }
-        }
-		
-		if (!pieceCanReach) {
-			free(offsetPosition);
-			return NULL;
-		}
+static sskSemanticAnalyzerError _sskSemanticAnalyzeInContext(sskAnalyzerContext * context, sskMoveList moveList, const char * startingPosition, sskSemanticAnalyzerOptions options) {
+	const sskStartPositionCacheEntry * startEntry;
+	sskSemanticAnalyzerError error;
+	
+	// Move List is NULL.
+	if (moveList == NULL) { return sskSemanticAnalyzerErrorProvidedMoveListEmpty; }
+	
+	// Starting FEN not specified
+	if (startingPosition == NULL || strlen(startingPosition) == 0) {
+		return sskSemanticAnalyzerErrorFirstPositionNotSpecified;
 	}
-    
-    // If move is castling, verify that the king is not under check and
-    // all the squares between king and castling detination are not under check.
-    if (move->castlingType != sskCastlingTypeNone) {
-        if (move->didUpdateSelfKingStatus && (move->selfKingStatus == sskKingStatusCheck || move->selfKingStatus == sskKingStatusCheckMate)) {
-            free(offsetPosition);
-            return NULL;
-        } else if (sskIsKingUnderCheck(bitboardPosition, SSK_GET_PIECE_COLOR(move->pieceMoved), kFalse, NULL) > 0) {
-            free(offsetPosition);
-            return NULL;
-        }
-        
-        // verify if each square between king and the castling destination square
-        // is not under check by any opponent piece.
-        sskOffsetPosition castleEvalOffsetPosition = sskCopyOffsetPosition(offsetPosition);
-        sskBitboardPosition * castleEvalBitboardPosition = NULL;
-        sskChessSquare i = sskFirstOneIndex(sskBitmapForPieceInBitboardPosition(bitboardPosition, move->pieceMoved)); // Mark current king square
-    
-        switch (move->castlingType) {
-            case sskCastlingTypeWKSide: {
-                for (i = i + 1; i <= SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('g', '1'); i++) {
-                    castleEvalOffsetPosition[i - 1] = sskChessPieceNone;   // Vacate the left square and occupy next square
-                    castleEvalOffsetPosition[i] = sskChessPieceWKing;      // Occupy current square with White King
-                    castleEvalBitboardPosition = sskOffsetPositionToBitboardPosition(castleEvalOffsetPosition);   // Obtain position in bitboard format from adjusted offset position.
-                    numChecks = sskIsKingUnderCheck(*castleEvalBitboardPosition, sskChessColorWhite, kTrue, NULL);
-
-                    free(castleEvalBitboardPosition);
-                    if (numChecks > 0) break;
-                }
-                break;
-            }
-                
-            case sskCastlingTypeWQSide: {
-                
-                for (i = i - 1; i >= SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('c', '1'); i--) {
-                    castleEvalOffsetPosition[i + 1] = sskChessPieceNone;   // Vacate the right square and occupy next square
-                    castleEvalOffsetPosition[i] = sskChessPieceWKing;      // Occupy current square with White King
-                    castleEvalBitboardPosition = sskOffsetPositionToBitboardPosition(castleEvalOffsetPosition);   // Obtain position in bitboard format from adjusted offset position.
-                    numChecks = sskIsKingUnderCheck(*castleEvalBitboardPosition, sskChessColorWhite, kTrue, NULL);
-                    
-                    free(castleEvalBitboardPosition);
-                    if (numChecks > 0) break;
-                }
-                break;
-            }
-                
-            case sskCastlingTypeBKSide: {
-                for (i = i + 1; i <= SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('g', '8'); i++) {
-                    castleEvalOffsetPosition[i - 1] = sskChessPieceNone;   // Vacate the left square and occupy next square
-                    castleEvalOffsetPosition[i] = sskChessPieceBKing;      // Occupy current square with Black King
-                    castleEvalBitboardPosition = sskOffsetPositionToBitboardPosition(castleEvalOffsetPosition);   // Obtain position in bitboard format from adjusted offset position.
-                    numChecks = sskIsKingUnderCheck(*castleEvalBitboardPosition, sskChessColorBlack, kTrue, NULL);
-                    
-                    free(castleEvalBitboardPosition);
-                    if (numChecks > 0) break;
-                }
-                break;
-            }
-                
-            case sskCastlingTypeBQSide: {
-                for (i = i - 1; i >= SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR('c', '8'); i--) {
-                    castleEvalOffsetPosition[i + 1] = sskChessPieceNone;   // Vacate the left square and occupy next square
-                    castleEvalOffsetPosition[i] = sskChessPieceBKing;      // Occupy current square with Black King
-                    castleEvalBitboardPosition = sskOffsetPositionToBitboardPosition(castleEvalOffsetPosition);   // Obtain position in bitboard format from adjusted offset position.
-                    numChecks = sskIsKingUnderCheck(*castleEvalBitboardPosition, sskChessColorBlack, kTrue, NULL);
-                    
-                    free(castleEvalBitboardPosition);
-                    if (numChecks > 0) break;
-                }
-                break;
-            }
-        }
-        
-        free(castleEvalOffsetPosition);
-        
-        if (numChecks > 0) {
-            free(offsetPosition);
-            return NULL;
-        }
-    }
-    
-    // Update the move in offset position.
-    offsetPosition[move->fromSquare] = sskChessPieceNone;	// vacate fromSquare
-    offsetPosition[move->toSquare] = move->pieceMoved;	// occupy toSquare
-    
-    // Special Case: Castling
-    if (SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved) == sskChessPieceKing) {
-        switch (move->castlingType) {
-            case sskCastlingTypeWKSide: {
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR(move->castlingStatus[0], '1') ] = sskChessPieceNone;	// vacate rook square
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(5, 0) ] = sskChessPieceWRook;								// occupy rook square
-                break;
-            }
-            case sskCastlingTypeWQSide: {
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR(move->castlingStatus[1], '1') ] = sskChessPieceNone;	// vacate rook square
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(3, 0) ] = sskChessPieceWRook;								// occupy rook square
-                break;
-            }
-            case sskCastlingTypeBKSide: {
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR(move->castlingStatus[2], '8') ] = sskChessPieceNone;	// vacate rook square
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(5, 7) ] = sskChessPieceBRook;								// occupy rook square
-                break;
-            }
-            case sskCastlingTypeBQSide: {
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_CHAR(move->castlingStatus[3], '8') ] = sskChessPieceNone;	// vacate rook square
-                offsetPosition[ SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(3, 7) ] = sskChessPieceBRook;								// occupy rook square
-                break;
-            }
-        }
-        offsetPosition[move->toSquare] = move->pieceMoved;    // Re-occupy toSquare with king in case it was vacated
-    }
-    
-    // Special Case: En-passant
-    if ((move->pieceMoved == sskChessPieceWPawn) && (move->toSquare == move->enPassantTarget)) {
-        offsetPosition[move->enPassantTarget - 8] = sskChessPieceNone;	// remove the black pawn on 5th rank
-    }
-    if ((move->pieceMoved == sskChessPieceBPawn) && (move->toSquare == move->enPassantTarget)) {
-        offsetPosition[move->enPassantTarget + 8] = sskChessPieceNone;	// remove the white pawn on 4th rank
-    }
 	
-	// Special Case: Promotion
-	if ((SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved) == sskChessPiecePawn) && move->promotedPiece != sskChessPieceNone) {
-		offsetPosition[move->toSquare] = (SSK_GET_PIECE_COLOR(move->pieceMoved) << 3) | move->promotedPiece;	// Place promoted piece on toSquare
+	// The game starts from a copy of the cached position, the analysis makes no heap allocation.
+	startEntry = _sskStartPositionInContext(context, startingPosition);
+	_sskInitGameStateWithPosition(&context->gameState, &startEntry->position, startEntry->piecesKey, startEntry->materialKey, options);
+	
+	error = _sskAnalyzeMovesInGameState(&context->gameState, moveList, NULL, NULL);
+	if (error == sskSemanticAnalyzerErrorAmbiguousMove) {
+		context->ambiguousHalfmoveNumber = context->gameState.ambiguousHalfmoveNumber;
 	}
-    
-    // Update bitboard
-    verificationBitboard = sskOffsetPositionToBitboardPosition(offsetPosition);
-    numChecks = sskIsKingUnderCheck(*verificationBitboard, SSK_GET_PIECE_COLOR(move->pieceMoved), kFalse, NULL);
-    
-    free(offsetPosition);
-    
-    if (numChecks > 0) {
-        free(verificationBitboard);
-        return NULL;
-    }
+	return error;
+}
 
-    return verificationBitboard;
+sskSemanticAnalyzerError sskSemanticAnalyzeInContext(sskAnalyzerContext * context, sskMoveList moveList, const char * startingPosition, sskSemanticAnalyzerOptions options) {
+	sskResetAnalyzerContext(context);
+	context->error = _sskSemanticAnalyzeInContext(context, moveList, startingPosition, options);
+	return context->error;
 }
 
-unsigned short sskIsKingUnderCheck(sskBitboardPosition bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare) {
-	unsigned short numChecks = 0;
-	sskChessPiece i;
-	sskChessSquare fromSquare, toSquare;
-	sskBitmap pieceBitmap;
-	
-	// Set the king's square as toSquare.
-	toSquare = sskFirstOneIndex(sskBitmapForPieceInBitboardPosition(bitboardPosition, (kingColor == sskChessColorWhite)?sskChessPieceWKing:sskChessPieceBKing));
-	
-	// Iterate all the opponent pieces(king if needed) and find if they can reach the king.
-	for (i = ((kingColor == sskChessColorWhite)?sskChessPieceBPawn:sskChessPieceWPawn);
-		 i <= ((kingColor == sskChessColorWhite)?sskChessPieceBKnight:sskChessPieceWKnight);
-		 i++) {
-		if (SSK_GET_GENERIC_PIECE_CODE(i) == sskChessPieceKing && !shouldIncludeKing) continue;	// Skip King if required.
-		
-		pieceBitmap = sskBitmapForPieceInBitboardPosition(bitboardPosition, i);
-		while (pieceBitmap) {
-			fromSquare = sskFirstOneIndex(pieceBitmap);
-			pieceBitmap = pieceBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
-			if (sskIsSquareReachable(bitboardPosition, fromSquare, toSquare, -1, NULL)) {
-				if (checkingPieceSquare != NULL) *checkingPieceSquare = fromSquare;
-				numChecks++;
-			}
-		}
+#pragma mark - Incremental analysis functions
+
+void sskInitGameState(sskGameState * gameState, const char * startingPosition, sskChessColor sideToMove, const char castlingStatus[5], sskSemanticAnalyzerOptions options) {
+	kBool hasStartingPosition = (startingPosition != NULL && strlen(startingPosition) > 0) ? kTrue : kFalse;
+	sskChessPiece offsetPosition[64];
+	sskPosition position;
+	
+	sskInitBitboards();
+	
+	// A missing position leaves the board empty, the game fails at its first move.
+	memset(offsetPosition, 0, sizeof(offsetPosition));
+	if (hasStartingPosition) {
+		sskFillOffsetPositionWithxFEN(offsetPosition, startingPosition);
 	}
+	sskOffsetPositionToPosition(offsetPosition, &position);
+	_sskInitGameStateWithPosition(gameState, &position, sskZobristKeyForPiecesInPosition(&position), sskMaterialKeyForPosition(&position), options);
+	
+	// The first move gets the status of the start position.
+	gameState->sideToMove = sideToMove;
+	strcpy(gameState->castlingStatus, castlingStatus);
+	gameState->hasMoveStatus = kTrue;
 	
-	return numChecks;
+	if (!hasStartingPosition) {
+		gameState->error = sskSemanticAnalyzerErrorFirstPositionNotSpecified;
+	}
 }
 
-kBool sskIsKingUnderCheckMate(sskBitboardPosition bitboardPosition, sskChessColor kingColor, int numChecks, int enpassantTarget) {
-	sskChessSquare checkingPieceSquare = 0;
-	sskBitmap checkPathBitmap = SSK_EMPTY_BITMAP, kingBitmap = SSK_EMPTY_BITMAP, pieceBitmap = SSK_EMPTY_BITMAP, pieceAttackBitmap = SSK_EMPTY_BITMAP;
-	kBool pieceCanBlock = kFalse, underPin, kingCanEscape;
-	int i, j;
-	sskChessSquare fromSquare;
+sskSemanticAnalyzerError sskAnalyzeMovesInGameState(sskGameState * gameState, sskMoveList moveList) {
+	sskMove * lastMove;
 	
-	if (numChecks == 0) return kFalse;
-	numChecks = sskIsKingUnderCheck(bitboardPosition, kingColor, kTrue, &checkingPieceSquare);
-    if (numChecks == 0) return kFalse;
+	if (gameState->error != sskSemanticAnalyzerErrorNone) { return gameState->error; }
+	if (moveList == NULL) { return sskSemanticAnalyzerErrorProvidedMoveListEmpty; }
 	
-	// Check if king has an escape square
-	kingCanEscape = sskCanKingEscape(bitboardPosition, kingColor);
+	// Link the moves after the last one of the game.
+	if (gameState->lastMove == NULL) {
+		gameState->moveList = moveList;
+	} else {
+		gameState->lastMove->next = moveList;
+		moveList->prev = gameState->lastMove;
+	}
 	
-	if (kingCanEscape) return kFalse;
-		
-	// When just 1 piece is issuing check,
-	// see if any piece can block the check.
+	for (lastMove = moveList; lastMove->next != NULL; lastMove = lastMove->next);
+	gameState->lastMove = lastMove;
 	
+	gameState->error = _sskAnalyzeMovesInGameState(gameState, moveList, NULL, NULL);
+	return gameState->error;
+}
+
+sskSemanticAnalyzerError sskAppendMovesToGameState(sskGameState * gameState, char * input, int * errorIndex) {
+	sskMoveList moveList;
 	
-    if (!kingCanEscape && (numChecks == 1)) {
-		kingBitmap = sskBitmapForPieceInBitboardPosition(bitboardPosition, (kingColor << 3) | sskChessPieceKing);
-        sskIsSquareReachable(bitboardPosition, checkingPieceSquare, sskFirstOneIndex(kingBitmap), -1, &checkPathBitmap);
-		
-		// modify checkpath bitmap to set the checkingPieceSquare and unset king's square
-		checkPathBitmap = checkPathBitmap | SSK_BITMAP_SET_SQUARE_IDX(checkingPieceSquare);
-		checkPathBitmap = checkPathBitmap & (~kingBitmap);
-		
-		pieceCanBlock = kFalse;
+	*errorIndex = -1;
+	if (gameState->error != sskSemanticAnalyzerErrorNone) { return gameState->error; }
+	
+	moveList = sskLexicalAnalyze(input, errorIndex, gameState->halfmove, gameState->sideToMove);
+	if (moveList == NULL) { return sskSemanticAnalyzerErrorProvidedMoveListEmpty; }
+	
+	return sskAnalyzeMovesInGameState(gameState, moveList);
+}
+
+#pragma mark - Parallel analysis functions
+
+/** A range of replayed plies annotated by one thread. */
+typedef struct _sskAnnotationTask {
+	sskReplayedPly *	plies;
+	unsigned int		numPlies;
+	kBool				shouldComputeGameEnd;
+	kBool				shouldComputeChecks;
+	kBool				shouldFillPlacements;
+} sskAnnotationTask;
+
+/** Fills the king status and placements of a range of replayed plies, as the sequential analysis would. */
+static void * _sskAnnotatePlies(void * annotationTask) {
+	const sskAnnotationTask * task = (const sskAnnotationTask *)annotationTask;
+	const sskReplayedPly * ply;
+	sskPositionState sideState;
+	sskKingStatus opponentKingStatus;
+	sskMove * move;
+	kBool opponentHasLegalMove;
+	unsigned int i;
+	
+	for (i = 0; i < task->numPlies; i++) {
+		ply = &task->plies[i];
+		move = ply->move;
 		
-		// Iterate all kingColor pieces to verify if at least can reach a square in checkpath.
-		while (checkPathBitmap) {	// Outer Loop Iterates Squares in check path map
-			i = sskFirstOneIndex(checkPathBitmap);
-			checkPathBitmap = checkPathBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(i);
+		if (ply->shouldUpdateSelfKingStatus && task->shouldComputeChecks) {
+			if (sskIsKingUnderCheckInPosition(&ply->positionBeforeMove, SSK_GET_PIECE_COLOR(move->pieceMoved), kFalse, NULL) > 0) {
+				move->selfKingStatus = sskKingStatusCheck;
+			}
 			
-			for (j = ((kingColor << 3) | sskChessPiecePawn);
-				 j <= ((kingColor << 3) | sskChessPieceKnight); j++) {	// Inner Loop Iterates all pieces
-				if (SSK_GET_GENERIC_PIECE_CODE(j) == sskChessPieceKing) continue;	// Skip King
+			if (task->shouldComputeGameEnd) {
+				sideState.sideToMove = SSK_GET_PIECE_COLOR(move->pieceMoved);
+				strcpy(sideState.castlingStatus, move->castlingStatus);
+				sideState.enPassantTarget = move->enPassantTarget;
 				
-				pieceBitmap = sskBitmapForPieceInBitboardPosition(bitboardPosition, j);
-				while (pieceBitmap) {
-					fromSquare = sskFirstOneIndex(pieceBitmap);
-					pieceBitmap = pieceBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
-					
-					if (sskIsSquareReachable(bitboardPosition, fromSquare, i, enpassantTarget, &pieceAttackBitmap)) {
-						// Verify Pin Condition
-						sskOffsetPosition offsetPosition = sskBitboardPositionToOffsetPosition(bitboardPosition);
-						sskChessSquare pinCausingPieceSquare;
-						underPin = sskIsSquarePinned(bitboardPosition, offsetPosition, fromSquare, sskFirstOneIndex(kingBitmap), kingColor, &pinCausingPieceSquare);
-						free(offsetPosition);
-						if (!underPin) {
-							pieceCanBlock = kTrue;
-							break;
-						}
-					}
+				if (!sskHasLegalMove(&ply->positionBeforeMove, &sideState)) {
+					move->selfKingStatus = (move->selfKingStatus == sskKingStatusCheck) ? sskKingStatusCheckMate : sskKingStatusStalemate;
 				}
-				
-				if (pieceCanBlock) break;
 			}
-			
-			if (pieceCanBlock) break;
+			move->didUpdateSelfKingStatus = kTrue;
+		}
+		
+		if (task->shouldFillPlacements) {
+			sskFillPiecePlacementWithPosition(move->piecePlacementBeforeMove, &ply->positionBeforeMove);
 		}
-    }    
-    
-	// Else condition: More than 1 piece is issuing
-	// check and king can't escape -> Checkmate
-	return !pieceCanBlock;
-}
-
-kBool sskIsKingUnderStalemate(sskBitboardPosition bitboardPosition, sskChessColor kingColor, int enpassantTarget) {
-	if (sskCanKingEscape(bitboardPosition, kingColor)) return kFalse;
-	int i;
-	kBool legalMoveExists;
-	sskBitmap pieceBitmap, pieceAttacksBitmap, pieceAllAttacksBitmap;
-	kBool underPin;
-	sskChessSquare fromSquare, pinnerSquare, kingSquare, toSquare;
-	sskOffsetPosition offsetPosition = NULL;
-	
-	kingSquare = sskFirstOneIndex(sskBitmapForPieceInBitboardPosition(bitboardPosition, ((kingColor << 3) | sskChessPieceKing)));
-	legalMoveExists = kFalse;
-	
-	// Look for atleast a single legal move of kingColor pieces (except king)
-	for (i = ((kingColor << 3) | sskChessPiecePawn); i <= ((kingColor << 3) | sskChessPieceKnight); i++) {	// Iterate pieces
-		if (SSK_GET_GENERIC_PIECE_CODE(i) == sskChessPieceKing) continue;	// Skip King
 		
-		pieceBitmap = sskBitmapForPieceInBitboardPosition(bitboardPosition, i);
-		while (pieceBitmap) {
-			fromSquare = sskFirstOneIndex(pieceBitmap);
-			pieceBitmap = pieceBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
+		// The move that stopped the replay was not played.
+		if (!ply->isComplete) continue;
+		
+		if (task->shouldComputeChecks) {
+			opponentHasLegalMove = kTrue;
+			if (task->shouldComputeGameEnd) {
+				sideState.sideToMove = !SSK_GET_PIECE_COLOR(move->pieceMoved);
+				strcpy(sideState.castlingStatus, ply->castlingStatusAfterMove);
+				sideState.enPassantTarget = ply->enPassantTargetAfterMove;
+				opponentHasLegalMove = sskHasLegalMove(&ply->positionAfterMove, &sideState);
+			}
 			
-            pieceAllAttacksBitmap = sskBitmapForAllPieceAttacksInBitboardPosition(bitboardPosition, i, fromSquare);
-            
-			// Compute the squares that the piece can probably reach.
-			while (pieceAllAttacksBitmap) {
-                toSquare = sskFirstOneIndex(pieceAllAttacksBitmap);
-                pieceAllAttacksBitmap = pieceAllAttacksBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(toSquare);
-                
-                if (sskIsSquareReachable(bitboardPosition, fromSquare, toSquare, enpassantTarget, &pieceAttacksBitmap)) {
-					offsetPosition = sskBitboardPositionToOffsetPosition(bitboardPosition);
-					underPin = sskIsSquarePinned(bitboardPosition, offsetPosition, fromSquare, kingSquare, kingColor, &pinnerSquare);
-					free(offsetPosition);
-					if (!underPin) {
-						legalMoveExists = kTrue;
-						break;
-					} else if (underPin && (pieceAttacksBitmap & SSK_BITMAP_SET_SQUARE_IDX(pinnerSquare))) {
-						legalMoveExists = kTrue;
-						break;
-					}
-				}
-            }
-            
-			if (legalMoveExists) break;
+			if (sskIsKingUnderCheckInPosition(&ply->positionAfterMove, !SSK_GET_PIECE_COLOR(move->pieceMoved), kFalse, NULL) > 0) {
+				opponentKingStatus = opponentHasLegalMove ? sskKingStatusCheck : sskKingStatusCheckMate;
+			} else {
+				opponentKingStatus = opponentHasLegalMove ? sskKingStatusNone : sskKingStatusStalemate;
+			}
+			
+			if (opponentKingStatus != sskKingStatusNone) {
+				move->opponentKingStatus = opponentKingStatus;
+				move->didUpdateOpponentKingStatus = kTrue;
+			}
+			
+			// The next move's status is written here only, its own ply never updates it.
+			if (move->next != NULL) {
+				move->next->selfKingStatus = opponentKingStatus;
+				move->next->didUpdateSelfKingStatus = kTrue;
+			}
 		}
 		
-		if (legalMoveExists) break;
+		if (task->shouldFillPlacements) {
+			sskFillPiecePlacementWithPosition(move->piecePlacementAfterMove, &ply->positionAfterMove);
+		}
 	}
 	
-	return !legalMoveExists;
+	return NULL;
 }
 
-kBool sskCanKingEscape(sskBitboardPosition bitboardPosition, sskChessColor kingColor) {
-	// Check to see if king has an escape square.
-    sskOffsetPosition checkEvalOffsetPosition = sskBitboardPositionToOffsetPosition(bitboardPosition);
-    sskBitboardPosition * checkEvalBitboardPosition = NULL;
-    int i, prevSquare = -1;
-    sskChessPiece prevPiece = sskChessPieceNone;
-	
-    // Obtain reachable squares for king in a bitmap.
-    sskChessSquare kingSquare = sskFirstOneIndex(sskBitmapForPieceInBitboardPosition(bitboardPosition, (kingColor == sskChessColorWhite)?sskChessPieceWKing:sskChessPieceBKing));
-    sskBitmap kingBitmap = sskBitmapWithKingReach(kingSquare);
-    kingBitmap = (kingBitmap ^ ((kingColor == sskChessColorWhite)?bitboardPosition.wOccupied:bitboardPosition.bOccupied)) & sskBitmapWithKingReach(kingSquare);
-	kingBitmap = kingBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(kingSquare);	// Exclude the kingSquare.
-	kBool canEscape = kFalse;
+sskSemanticAnalyzerError sskSemanticAnalyzeInParallel(sskMoveList moveList, char * startingPosition, sskSemanticAnalyzerOptions options, unsigned int numThreads, int * ambiguousHalfmoveNumber) {
+	sskAnnotationTask tasks[SSK_MAX_ANNOTATION_THREADS];
+#if SSK_USE_PTHREADS
+	pthread_t threads[SSK_MAX_ANNOTATION_THREADS];
+	kBool didCreateThread[SSK_MAX_ANNOTATION_THREADS];
+#endif
+	sskSemanticAnalyzerError error, replayError;
+	sskReplayedPly * replayedPlies;
+	unsigned int numMoves = 0, numReplayedPlies = 0, pliesPerThread, i;
+	sskGameState gameState;
+	sskMove * trav;
+	
+	// Move List is NULL.
+	if (moveList == NULL) { return sskSemanticAnalyzerErrorProvidedMoveListEmpty; }
+	
+	// Starting FEN not specified
+	if (startingPosition == NULL || strlen(startingPosition) == 0) {
+		return sskSemanticAnalyzerErrorFirstPositionNotSpecified;
+	}
+	
+	for (trav = moveList; trav != NULL; trav = trav->next) numMoves++;
+	// The recorded positions are cache line aligned, which malloc() does not guarantee.
+	replayedPlies = (sskReplayedPly *)SSK_ALIGNED_MALLOC(64, sizeof(sskReplayedPly) * numMoves);
+	if (replayedPlies == NULL) {
+		return sskSemanticAnalyzeWithOptions(moveList, startingPosition, options, ambiguousHalfmoveNumber);
+	}
+	
+	/*------------ Replay, recording the positions around each move -----------*/
+	// The first move carries its own status, as with sskSemanticAnalyzeWithOptions().
+	sskInitGameState(&gameState, startingPosition, sskChessColorWhite, moveList->castlingStatus, options);
+	gameState.hasMoveStatus = kFalse;
+	replayError = _sskAnalyzeMovesInGameState(&gameState, moveList, replayedPlies, &numReplayedPlies);
+	
+	/*------------ Annotate ranges of plies on the threads -----------*/
+	if (numThreads > SSK_MAX_ANNOTATION_THREADS) numThreads = SSK_MAX_ANNOTATION_THREADS;
+	if (numThreads > (numReplayedPlies + SSK_MIN_PLIES_PER_THREAD - 1) / SSK_MIN_PLIES_PER_THREAD) {
+		numThreads = (numReplayedPlies + SSK_MIN_PLIES_PER_THREAD - 1) / SSK_MIN_PLIES_PER_THREAD;
+	}
+	if (numThreads == 0) numThreads = 1;
+	pliesPerThread = (numReplayedPlies + numThreads - 1) / numThreads;
+	if (pliesPerThread > 0) numThreads = (numReplayedPlies + pliesPerThread - 1) / pliesPerThread;
+	
+	for (i = 0; i < numThreads; i++) {
+		tasks[i].plies = replayedPlies + i * pliesPerThread;
+		tasks[i].numPlies = (i == numThreads - 1) ? numReplayedPlies - i * pliesPerThread : pliesPerThread;
+		tasks[i].shouldComputeGameEnd = (options & sskSemanticAnalyzerOptionSkipGameEnd) ? kFalse : kTrue;
+		tasks[i].shouldComputeChecks = (tasks[i].shouldComputeGameEnd || !(options & sskSemanticAnalyzerOptionSkipChecks)) ? kTrue : kFalse;
+		tasks[i].shouldFillPlacements = (options & sskSemanticAnalyzerOptionSkipPlacements) ? kFalse : kTrue;
+	}
+	
+	// The calling thread takes the last range, and any range whose thread could not be created.
+#if SSK_USE_PTHREADS
+	for (i = 0; i + 1 < numThreads; i++) {
+		didCreateThread[i] = (pthread_create(&threads[i], NULL, _sskAnnotatePlies, &tasks[i]) == 0) ? kTrue : kFalse;
+		if (!didCreateThread[i]) _sskAnnotatePlies(&tasks[i]);
+	}
+	_sskAnnotatePlies(&tasks[numThreads - 1]);
+	for (i = 0; i + 1 < numThreads; i++) {
+		if (didCreateThread[i]) pthread_join(threads[i], NULL);
+	}
+#else
+	for (i = 0; i < numThreads; i++) {
+		_sskAnnotatePlies(&tasks[i]);
+	}
+#endif
+	
+	/*------------ Game end, which the replay could not see -----------*/
+	// No move is legal after checkmate or stalemate, so the replay stopped at the move after it.
+	// That move was only verified, the sequential analysis would not have looked at it at all.
+	error = replayError;
+	for (i = 0; i < numReplayedPlies; i++) {
+		trav = replayedPlies[i].move;
+		if (trav->selfKingStatus == sskKingStatusCheckMate || trav->selfKingStatus == sskKingStatusStalemate) {
+			trav->fromSquare = replayedPlies[i].lexedFromSquare;
+			trav->toSquare = replayedPlies[i].lexedToSquare;
+			error = sskSemanticAnalyzerErrorMovesExistAfterGameEnd;
+			break;
+		}
+		
+		// A checkmate on the last move stands over the move rules.
+		if (trav->opponentKingStatus == sskKingStatusCheckMate && (trav->drawStatus == sskDrawStatusSeventyFiveMoveRule || trav->drawStatus == sskDrawStatusFiftyMoveRule)) {
+			trav->drawStatus = (trav->positionRepetitions >= 3) ? sskDrawStatusThreefoldRepetition : sskDrawStatusNone;
+		}
+	}
+	
+	if (error == sskSemanticAnalyzerErrorAmbiguousMove && ambiguousHalfmoveNumber != NULL) {
+		*ambiguousHalfmoveNumber = gameState.ambiguousHalfmoveNumber;
+	}
+	
+	free(replayedPlies);
+	return error;
+}
+
+#pragma mark - Semantic analysis and legality verification functions
+
+kBool sskFillFromSquareInPosition(const sskPosition * position, sskMove * move, kBool * ambiguity) {
+    sskChessColor color = SSK_GET_PIECE_COLOR(move->pieceMoved);
+    sskBitmap origins;
+	*ambiguity = kFalse;
     
-    // Put the king on each reachable square and see if its under check
-    // before going to the next state, restore.
-    for (i = sskFirstOneIndex(kingBitmap); kingBitmap != SSK_EMPTY_BITMAP; i = sskFirstOneIndex(kingBitmap)) {
-        if (prevSquare != -1) {
-            checkEvalOffsetPosition[prevSquare] = prevPiece;
+    // Castling names its squares itself, only the right and the path need checking.
+    if ((SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved) == sskChessPieceKing) && (move->castlingType != sskCastlingTypeNone)) {
+        sskChessSquare castlingKingSquare, castlingKingToSquare, castlingRookSquare, castlingRookToSquare;
+        if (!_sskFillCastlingSquares(position, move->castlingStatus, move->castlingType, &castlingKingSquare, &castlingKingToSquare, &castlingRookSquare, &castlingRookToSquare) ||
+            !_sskIsCastlingPathClear(position, color, castlingKingSquare, castlingKingToSquare, castlingRookSquare, castlingRookToSquare)) {
+            return kFalse; // Castling not possible
         }
-        
-        kingBitmap = kingBitmap & SSK_BITMAP_UNSET_SQUARE_IDX(i);
-        
-        // Store the current square being set
-        // for restoration at next iteration.
-        prevPiece = checkEvalOffsetPosition[i];
-        prevSquare = i;
+        move->fromSquare = castlingKingSquare;
+        move->toSquare = castlingKingToSquare;
+        return kTrue;
+    }
+    
+    origins = sskBitmapWithMoveOriginsInPosition(position, move);
+    if (origins == SSK_EMPTY_BITMAP) return kFalse; // None of the pieces could reach the destination
+    
+    *ambiguity = sskCheckMoveAmbiguityAndFillFromSquareWithOrigins(origins, move);
+	return kTrue;
+}
+
+kBool sskFillFromSquareRef(const sskBitboardPosition * bitboardPosition, sskOffsetPosition offsetPosition, sskMove * move, kBool * ambiguity) {
+	sskPosition position;
+	(void)offsetPosition;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskFillFromSquareInPosition(&position, move, ambiguity);
+}
+
+kBool sskFillFromSquare(sskBitboardPosition bitboardPosition, sskOffsetPosition offsetPosition, sskMove * move, kBool * ambiguity) {
+	return sskFillFromSquareRef(&bitboardPosition, offsetPosition, move, ambiguity);
+}
+
+kBool sskCheckLegalInPosition(const sskPosition * position, sskMove * move, kBool moveWasPseudoLegalChecked, sskPosition * resultingPosition) {
+    sskPosition verificationPosition;
+    sskUndoRecord undoRecord;
+    sskChessColor color = SSK_GET_PIECE_COLOR(move->pieceMoved);
+    sskChessSquare castlingKingSquare, castlingKingToSquare, castlingRookSquare, castlingRookToSquare;
+	
+	// If move is castling, the right, the king's and rook's squares and both paths are checked here.
+	if (move->castlingType != sskCastlingTypeNone) {
+		if (!_sskFillCastlingSquares(position, move->castlingStatus, move->castlingType, &castlingKingSquare, &castlingKingToSquare, &castlingRookSquare, &castlingRookToSquare)) return kFalse;
+		if (move->fromSquare != castlingKingSquare || move->toSquare != castlingKingToSquare) return kFalse;
+		if (!moveWasPseudoLegalChecked && !_sskIsCastlingPathClear(position, color, castlingKingSquare, castlingKingToSquare, castlingRookSquare, castlingRookToSquare)) return kFalse;
 		
-        checkEvalOffsetPosition[i] = (kingColor << 3) | sskChessPieceKing; // Place king on reachable square.
-        checkEvalOffsetPosition[kingSquare] = sskChessPieceNone;
+		// Neither the king's square nor any square it passes or lands on may be attacked. The king
+		// is lifted from the occupancy so that sliders along the back rank see through it.
+		sskBitmap attackedSquares = sskBitmapWithSquaresAttackedBySideInPosition(position, !color, sskBitmapForOccupancyInPosition(position) & SSK_BITMAP_UNSET_SQUARE_IDX(castlingKingSquare));
+		if (sskBitmapWithCastlingKingPath(castlingKingSquare, castlingKingToSquare) & attackedSquares) return kFalse;
+	} else if (!moveWasPseudoLegalChecked) {
+		sskBitmap attackMap, pinnedPieces;
+		sskChessSquare kingSquare;
 		
-        checkEvalBitboardPosition = sskOffsetPositionToBitboardPosition(checkEvalOffsetPosition);
-        if (sskIsKingUnderCheck(*checkEvalBitboardPosition, kingColor, kTrue, NULL) == 0) canEscape = kTrue;
-        free(checkEvalBitboardPosition);
+		if (sskIsSquareReachableInPosition(position, move->fromSquare, move->toSquare, (move->enPassantTarget != 0)?move->enPassantTarget:-1, &attackMap) == kFalse) return kFalse;
 		
-		if (canEscape) break;
+		// A pinned piece must stay on the pin line, capturing the pinner or maintaining the pin.
+		// If piece is a king, we can skip checking for pins.
+		if (SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved) != sskChessPieceKing) {
+			kingSquare = sskFirstOneIndex(sskBitmapForPieceInPosition(position, (color << 3) | sskChessPieceKing));
+			pinnedPieces = sskBitmapWithPinnedPiecesInPosition(position, color, NULL);
+			if (!(sskBitmapWithPinAllowedSquares(pinnedPieces, kingSquare, move->fromSquare) & SSK_BITMAP_SET_SQUARE_IDX(move->toSquare))) return kFalse;
+		}
 	}
+    
+    // Play the move on a copy and verify that it does not leave the own king under check.
+    verificationPosition = *position;
+    sskMakeMoveInPosition(&verificationPosition, move, &undoRecord);
+    
+    if (sskIsKingUnderCheckInPosition(&verificationPosition, color, kFalse, NULL) > 0) return kFalse;
 
-	return canEscape;
+    if (resultingPosition != NULL) *resultingPosition = verificationPosition;
+    return kTrue;
 }
 
-kBool sskIsSquareReachable(sskBitboardPosition bitboardPosition, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap) {
-	sskOffsetPosition offsetPosition = sskBitboardPositionToOffsetPosition(bitboardPosition);
-	sskChessPiece piece = SSK_GET_GENERIC_PIECE_CODE(offsetPosition[fromSquare]);
-	sskChessColor color = SSK_GET_PIECE_COLOR(offsetPosition[fromSquare]);
-    sskBitmap attacks = SSK_EMPTY_BITMAP;
+sskBitboardPosition * sskCheckLegalRef(const sskBitboardPosition * bitboardPosition, sskMove * move, kBool moveWasPseudoLegalChecked) {
+	sskPosition position, resultingPosition;
+	sskBitboardPosition * resultingBitboardPosition;
 	
-	// No piece exists on fromSquare
-	if (piece == sskChessPieceNone) return kFalse;
-    
-	// Same color piece exists on toSquare or castling - reject
-	if (SSK_GET_GENERIC_PIECE_CODE(offsetPosition[toSquare]) != sskChessPieceNone &&
-		SSK_GET_PIECE_COLOR(offsetPosition[toSquare]) == color) {
-		// Castling as special case
-		if ((fromSquare == toSquare) &&
-			(piece == sskChessPieceKing) &&
-			(isCastlingOrEnpassantTarget != -1)) {
-			// continue execution
-		} else if(SSK_GET_FILE_IDX(toSquare) == isCastlingOrEnpassantTarget) {
-			// continue execution
-		} else {
-			free(offsetPosition);
-			return kFalse;
-		}
-	}
-	
-	attacks = sskBitmapForSpecificPieceAttacksInBitboardPosition(bitboardPosition, offsetPosition[fromSquare], fromSquare, toSquare, isCastlingOrEnpassantTarget);
-	
-	free(offsetPosition);
-    if(attackMap != NULL) *attackMap = attacks;
-	if (attacks & SSK_BITMAP_SET_SQUARE_IDX(toSquare)) return kTrue;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	if (!sskCheckLegalInPosition(&position, move, moveWasPseudoLegalChecked, &resultingPosition)) return NULL;
 	
-	return kFalse;
+	resultingBitboardPosition = SSK_MALLOC(sizeof(sskBitboardPosition));
+	sskPositionToBitboardPosition(&resultingPosition, resultingBitboardPosition);
+	return resultingBitboardPosition;
 }
 
+sskBitboardPosition * sskCheckLegal(sskBitboardPosition bitboardPosition, sskMove * move, kBool moveWasPseudoLegalChecked) {
+	return sskCheckLegalRef(&bitboardPosition, move, moveWasPseudoLegalChecked);
+}
 
-kBool sskIsSquarePinned(sskBitboardPosition bitboardPosition, sskOffsetPosition offsetPosition, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare) {
-	if (pinnedSquare == behindSquare) {
-		return kFalse;
+/**
+ *	Toggles every bit a move changes. XOR being its own inverse, the same call plays
+ *	the move and takes it back.
+ */
+static void _sskToggleMoveInPosition(sskPosition * position, const sskUndoRecord * undoRecord) {
+	sskChessColor color = SSK_GET_PIECE_COLOR(undoRecord->movedPiece);
+	sskChessPiece arrivingPiece = (undoRecord->promotedPiece != sskChessPieceNone) ? undoRecord->promotedPiece : SSK_GET_GENERIC_PIECE_CODE(undoRecord->movedPiece);
+	sskBitmap fromBitmap = SSK_BITMAP_SET_SQUARE_IDX(undoRecord->fromSquare), toBitmap = SSK_BITMAP_SET_SQUARE_IDX(undoRecord->toSquare);
+	sskBitmap rookBitmap = SSK_BITMAP_SET_SQUARE_IDX(undoRecord->rookFromSquare) ^ SSK_BITMAP_SET_SQUARE_IDX(undoRecord->rookToSquare);
+	
+	// Captured piece first, the moving piece may arrive on its square.
+	if (undoRecord->capturedPiece != sskChessPieceNone) {
+		position->pieces[SSK_GET_GENERIC_PIECE_CODE(undoRecord->capturedPiece) - 1] ^= SSK_BITMAP_SET_SQUARE_IDX(undoRecord->capturedSquare);
+		position->colors[!color] ^= SSK_BITMAP_SET_SQUARE_IDX(undoRecord->capturedSquare);
 	}
 	
-	short pinnedFile = SSK_GET_FILE_IDX(pinnedSquare);
-	short pinnedRank = SSK_GET_RANK_IDX(pinnedSquare);
-	short behindFile = SSK_GET_FILE_IDX(behindSquare);
-	short behindRank = SSK_GET_RANK_IDX(behindSquare);
+	position->pieces[SSK_GET_GENERIC_PIECE_CODE(undoRecord->movedPiece) - 1] ^= fromBitmap;
+	position->pieces[arrivingPiece - 1] ^= toBitmap;
 	
-	sskBitmap behindToPinned, pinnedToPinner, blockers;
-	sskChessPiece pinner;
+	// The rook squares cancel out when no rook moves. In Chess960 the king may land on the
+	// rook's square, the XOR of both deltas still leaves that square occupied.
+	position->pieces[sskChessPieceRook - 1] ^= rookBitmap;
+	position->colors[color] ^= fromBitmap ^ toBitmap ^ rookBitmap;
+}
+
+void sskMakeMoveInPosition(sskPosition * position, const sskMove * move, sskUndoRecord * undoRecord) {
+	sskChessColor color = SSK_GET_PIECE_COLOR(move->pieceMoved);
+	sskChessSquare kingSquare, kingToSquare;
 	
-	// Find the relative position of pieceBehindSquare to pinnedSquare.
-	if (pinnedRank == behindRank) { // Same Rank
-		if (pinnedFile > behindFile) {	// East
-			// Obtain the mask for region: behind<->pinned and identify blockers there.
-			behindToPinned = (sskBitmapWithEastRank(pinnedSquare) ^ sskBitmapWithEastRank(behindSquare)) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare);
-			blockers = behindToPinned & bitboardPosition.occupied;
-			
-			// A piece exists in the region: behind<->pinned, so no pin!
-			if (blockers) { return kFalse; }
-			
-			// Obtain mask for region: pinned<->rest of the rank
-			pinnedToPinner = (sskBitmapWithEastRank(pinnedSquare));
-			blockers = pinnedToPinner & bitboardPosition.occupied;
-			
-			// There is no piece to create a pin
-			if (blockers == 0) return kFalse;
-			
-			*pinCausingPieceSquare = sskFirstOneIndex(blockers);
-			pinner = offsetPosition[*pinCausingPieceSquare];
-			
-			// The blocker is the same color as of the pinned piece
-			if (SSK_GET_PIECE_COLOR(pinner) == color) {	return kFalse; }
-			
-			if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceRook || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-				return kTrue;
-			} else {
-				return kFalse;
+	undoRecord->movedPiece = move->pieceMoved;
+	undoRecord->capturedPiece = sskChessPieceNone;
+	undoRecord->promotedPiece = sskChessPieceNone;
+	undoRecord->fromSquare = move->fromSquare;
+	undoRecord->toSquare = move->toSquare;
+	undoRecord->capturedSquare = move->toSquare;
+	undoRecord->rookFromSquare = undoRecord->rookToSquare = move->toSquare;
+	
+	switch (SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved)) {
+		case sskChessPieceKing: {
+			// The castling rook comes from the file in the castling status and lands on the f or d file.
+			if (move->castlingType != sskCastlingTypeNone) {
+				_sskFillCastlingSquares(position, move->castlingStatus, move->castlingType, &kingSquare, &kingToSquare, &undoRecord->rookFromSquare, &undoRecord->rookToSquare);
 			}
-		} else if (pinnedFile < behindFile) {	// West
-			// Obtain mask for region: pinned<->behind and identify blockers there.
-			behindToPinned = (sskBitmapWithWestRank(pinnedSquare) ^ sskBitmapWithWestRank(behindSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare));
-			blockers = behindToPinned & bitboardPosition.occupied;
-			
-			// A piece exists in the region: pinned<->behind, so no pin!
-			if (blockers) { return kFalse; }
-			
-			// Obtain mask for region: rest of rank<->pinned
-			pinnedToPinner = (sskBitmapWithWestRank(pinnedSquare));
-			blockers = pinnedToPinner & bitboardPosition.occupied;
-			
-			// There is no piece to create a pin
-			if (blockers == 0) { return kFalse; }
-			
-			*pinCausingPieceSquare = sskLastOneIndex(blockers);
-			pinner = offsetPosition[*pinCausingPieceSquare];
-			
-			// The blocker is the same color as of the pinned piece
-			if (SSK_GET_PIECE_COLOR(pinner) == color) { return kFalse; }
+			break;
+		}
 			
-			if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceRook || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-				return kTrue;
-			} else {
-				return kFalse;
+		case sskChessPiecePawn: {
+			// En passant captures the pawn that passed the target square.
+			if (move->toSquare == move->enPassantTarget && SSK_GET_RANK_IDX(move->toSquare) == ((color == sskChessColorWhite) ? 5 : 2)) {
+				undoRecord->capturedSquare = (color == sskChessColorWhite) ? move->toSquare - 8 : move->toSquare + 8;
 			}
-		}		
-	} else if (pinnedFile == behindFile) {	// Same File
-		if (pinnedRank > behindRank) {	// North
-			// Obtain the mask for region: behind<->pinned and identify blockers there.
-			behindToPinned = (sskBitmapWithNorthFile(pinnedSquare) ^ sskBitmapWithNorthFile(behindSquare)) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare);
-			blockers = behindToPinned & bitboardPosition.occupied;
-			
-			// A piece exists in the region: behind<->pinned, so no pin!
-			if (blockers) { return kFalse; }
-			
-			// Obtain mask for region: pinned<->rest of the rank
-			pinnedToPinner = (sskBitmapWithNorthFile(pinnedSquare));
-			blockers = pinnedToPinner & bitboardPosition.occupied;
-			
-			// There is no piece to create a pin
-			if (blockers == 0) return kFalse;
-			
-			*pinCausingPieceSquare = sskFirstOneIndex(blockers);
-			pinner = offsetPosition[*pinCausingPieceSquare];
 			
-			// The blocker is the same color as of the pinned piece
-			if (SSK_GET_PIECE_COLOR(pinner) == color) {	return kFalse; }
-			
-			if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceRook || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-				return kTrue;
-			} else {
-				return kFalse;
+			if (move->promotedPiece != sskChessPieceNone) {
+				undoRecord->promotedPiece = SSK_GET_GENERIC_PIECE_CODE(move->promotedPiece);
 			}
-		} else if (pinnedRank < behindRank) {	// South
-			// Obtain mask for region: pinned<->behind and identify blockers there.
-			behindToPinned = (sskBitmapWithSouthFile(pinnedSquare) ^ sskBitmapWithSouthFile(behindSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare));
-			blockers = behindToPinned & bitboardPosition.occupied;
-			
-			// A piece exists in the region: pinned<->behind, so no pin!
-			if (blockers) { return kFalse; }
-			
-			// Obtain mask for region: rest of rank<->pinned
-			pinnedToPinner = (sskBitmapWithSouthFile(pinnedSquare));
-			blockers = pinnedToPinner & bitboardPosition.occupied;
-			
-			// There is no piece to create a pin
-			if (blockers == 0) { return kFalse; }
-			
-			*pinCausingPieceSquare = sskLastOneIndex(blockers);
-			pinner = offsetPosition[*pinCausingPieceSquare];
-			
-			// The blocker is the same color as of the pinned piece
-			if (SSK_GET_PIECE_COLOR(pinner) == color) { return kFalse; }
-			
-			if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceRook || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-				return kTrue;
-			} else {
-				return kFalse;
+			break;
+		}
+	}
+	
+	// A castling king never captures, in Chess960 its own rook may stand on toSquare.
+	if (move->castlingType == sskCastlingTypeNone) {
+		undoRecord->capturedPiece = sskPieceOnSquareInPosition(position, undoRecord->capturedSquare);
+	}
+	
+	_sskToggleMoveInPosition(position, undoRecord);
+	
+	// Mailbox writes are ordered so that Chess960 overlaps of king and rook squares end right.
+	position->mailbox[undoRecord->fromSquare] = sskChessPieceNone;
+	position->mailbox[undoRecord->capturedSquare] = sskChessPieceNone;
+	if (undoRecord->rookFromSquare != undoRecord->rookToSquare) {
+		position->mailbox[undoRecord->rookFromSquare] = sskChessPieceNone;
+		position->mailbox[undoRecord->rookToSquare] = (color << 3) | sskChessPieceRook;
+	}
+	position->mailbox[undoRecord->toSquare] = (color << 3) | ((undoRecord->promotedPiece != sskChessPieceNone) ? undoRecord->promotedPiece : SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved));
+}
+
+sskZobristKey sskZobristKeyForMove(const sskUndoRecord * undoRecord) {
+	sskChessColor color = SSK_GET_PIECE_COLOR(undoRecord->movedPiece);
+	sskChessPiece arrivingPiece = (undoRecord->promotedPiece != sskChessPieceNone) ? ((color << 3) | undoRecord->promotedPiece) : undoRecord->movedPiece;
+	sskZobristKey key = sskZobristKeyForPieceOnSquare(undoRecord->movedPiece, undoRecord->fromSquare) ^ sskZobristKeyForPieceOnSquare(arrivingPiece, undoRecord->toSquare);
+	
+	key ^= sskZobristKeyForPieceOnSquare(undoRecord->capturedPiece, undoRecord->capturedSquare);
+	if (undoRecord->rookFromSquare != undoRecord->rookToSquare) {
+		key ^= sskZobristKeyForPieceOnSquare((color << 3) | sskChessPieceRook, undoRecord->rookFromSquare) ^ sskZobristKeyForPieceOnSquare((color << 3) | sskChessPieceRook, undoRecord->rookToSquare);
+	}
+	
+	return key;
+}
+
+sskMaterialKey sskMaterialKeyForMove(const sskUndoRecord * undoRecord) {
+	sskMaterialKey delta = 0;
+	
+	// Unsigned wrap-around: the sum with the key before the move is exact.
+	delta -= sskMaterialKeyForPieceOnSquare(undoRecord->capturedPiece, undoRecord->capturedSquare);
+	if (undoRecord->promotedPiece != sskChessPieceNone) {
+		delta -= sskMaterialKeyForPieceOnSquare(undoRecord->movedPiece, undoRecord->fromSquare);
+		delta += sskMaterialKeyForPieceOnSquare((SSK_GET_PIECE_COLOR(undoRecord->movedPiece) << 3) | undoRecord->promotedPiece, undoRecord->toSquare);
+	}
+	
+	return delta;
+}
+
+#pragma mark - Castling rights functions
+
+sskCastlingRights sskCastlingRightsFromStatus(const char castlingStatus[5]) {
+	sskCastlingRights rights = sskCastlingTypeNone;
+	int i;
+
+	for (i = 0; i < 4 && castlingStatus[i] != '\0'; i++) {
+		if (castlingStatus[i] != '-') rights |= (1 << i);
+	}
+
+	return rights;
+}
+
+void sskFillCastlingRightsUpdateMasks(const sskPosition * position, const char castlingStatus[5], sskCastlingRights updateMasks[64]) {
+	sskCastlingRights allRights = sskCastlingTypeWKSide | sskCastlingTypeWQSide | sskCastlingTypeBKSide | sskCastlingTypeBQSide;
+	sskCastlingRights rights = sskCastlingRightsFromStatus(castlingStatus);
+	sskBitmap king;
+	sskChessSquare kingSquare;
+	int i, slot;
+
+	for (i = 0; i < 64; i++) updateMasks[i] = allRights;
+
+	for (i = sskChessColorWhite; i <= sskChessColorBlack; i++) {
+		if (!(rights & (0x3 << (2 * i)))) continue;
+
+		king = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & position->colors[i] & sskBitmapWithRankMask(i * 7);
+		if (king == SSK_EMPTY_BITMAP) continue;
+
+		// Moving the king drops both rights of its side, a rook leaving or taken at home only its own.
+		kingSquare = sskFirstOneIndex(king);
+		updateMasks[kingSquare] &= ~(0x3 << (2 * i));
+		for (slot = 2 * i; slot < 2 * i + 2; slot++) {
+			if (rights & (1 << slot)) {
+				updateMasks[SSK_SQUARE_IDX_FOR_FILE_RANK_IDX(SSK_CHAR_2_FILE(tolower(castlingStatus[slot])), i * 7)] &= ~(1 << slot);
 			}
 		}
-	} else if ((pinnedFile < behindFile && pinnedRank < behindRank)
-			   && ((behindFile - pinnedFile) == (behindRank - pinnedRank))
-			   ) {	// Behind Square is in North East Diagonal
-		//printf("\n Behind Square NE Diagonal");
-		// Obtain mask for region: pinned<->behind and identify blockers there.
-		behindToPinned = (sskBitmapWithSouthWestDiagonal(pinnedSquare) ^ sskBitmapWithSouthWestDiagonal(behindSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare));
-		blockers = behindToPinned & bitboardPosition.occupied;
-		
-		// A piece exists in the region: pinned<->behind, so no pin!
-		if (blockers) { return kFalse; }
-		
-		// Obtain mask for region: rest of rank<->pinned
-		pinnedToPinner = (sskBitmapWithSouthWestDiagonal(pinnedSquare));
-		blockers = pinnedToPinner & bitboardPosition.occupied;
-		
-		// There is no piece to create a pin
-		if (blockers == 0) { return kFalse; }
-		
-		*pinCausingPieceSquare = sskLastOneIndex(blockers);
-		pinner = offsetPosition[*pinCausingPieceSquare];
-		
-		// The blocker is the same color as of the pinned piece
-		if (SSK_GET_PIECE_COLOR(pinner) == color) { return kFalse; }
+	}
+}
+
+#pragma mark - Move generation functions
+
+/** Appends a move from one square to every target square, as four promotions on the last ranks. */
+static unsigned short _sskAppendMoves(sskEncodedMove buffer[], unsigned short count, sskChessSquare fromSquare, sskBitmap targets, kBool isPawn) {
+	sskChessSquare toSquare;
+	
+	while (targets) {
+		toSquare = sskFirstOneIndex(targets);
+		targets &= SSK_BITMAP_UNSET_SQUARE_IDX(toSquare);
 		
-		if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceBishop || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-			return kTrue;
+		if (isPawn && (SSK_GET_RANK_IDX(toSquare) == 0 || SSK_GET_RANK_IDX(toSquare) == 7)) {
+			buffer[count++] = SSK_ENCODE_MOVE(fromSquare, toSquare, sskEncodedMoveFlagQueenPromotion);
+			buffer[count++] = SSK_ENCODE_MOVE(fromSquare, toSquare, sskEncodedMoveFlagRookPromotion);
+			buffer[count++] = SSK_ENCODE_MOVE(fromSquare, toSquare, sskEncodedMoveFlagBishopPromotion);
+			buffer[count++] = SSK_ENCODE_MOVE(fromSquare, toSquare, sskEncodedMoveFlagKnightPromotion);
 		} else {
-			return kFalse;
+			buffer[count++] = SSK_ENCODE_MOVE(fromSquare, toSquare, sskEncodedMoveFlagNone);
 		}
-	} else if ((pinnedFile > behindFile && pinnedRank < behindRank)
-			   && ((pinnedFile - behindFile) == (behindRank - pinnedRank))
-			   ) {	// Behind Square is in North West Diagonal
-		//printf("\n Behind Square NW Diagonal");
-		// Obtain mask for region: pinned<->behind and identify blockers there.
-		behindToPinned = (sskBitmapWithSouthEastDiagonal(pinnedSquare) ^ sskBitmapWithSouthEastDiagonal(behindSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare));
-		blockers = behindToPinned & bitboardPosition.occupied;
-		
-		// A piece exists in the region: pinned<->behind, so no pin!
-		if (blockers) { return kFalse; }
-		
-		// Obtain mask for region: rest of rank<->pinned
-		pinnedToPinner = (sskBitmapWithSouthEastDiagonal(pinnedSquare));
-		blockers = pinnedToPinner & bitboardPosition.occupied;
-		
-		// There is no piece to create a pin
-		if (blockers == 0) { return kFalse; }
-		
-		*pinCausingPieceSquare = sskLastOneIndex(blockers);
-		pinner = offsetPosition[*pinCausingPieceSquare];
-		
-		// The blocker is the same color as of the pinned piece
-		if (SSK_GET_PIECE_COLOR(pinner) == color) { return kFalse; }
-		
-		if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceBishop || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-			return kTrue;
-		} else {
-			return kFalse;
+	}
+	
+	return count;
+}
+
+/** Squares a piece other than the king attacks or, for a pawn, pushes to. Own pieces are not removed. */
+static sskBitmap _sskBitmapWithPieceTargets(const sskPosition * position, sskChessPiece genericPiece, sskChessSquare fromSquare, sskChessColor color, sskBitmap occupied) {
+	switch (genericPiece) {
+		case sskChessPiecePawn: {
+			return sskBitmapWithPawnSetPushes(SSK_BITMAP_SET_SQUARE_IDX(fromSquare), occupied, color) |
+				   (sskBitmapWithPawnSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(fromSquare), color) & position->colors[!color]);
 		}
-	} else if ((pinnedFile > behindFile && pinnedRank > behindRank)
-			   && ((pinnedFile - behindFile) == (pinnedRank  - behindRank))
-			   ) {	// Behind Square is in South East Diagonal
-		//printf("\n Behind Square SE Diagonal");
-		// Obtain mask for region: pinned<->behind and identify blockers there.
-		behindToPinned = (sskBitmapWithNorthEastDiagonal(pinnedSquare) ^ sskBitmapWithNorthEastDiagonal(behindSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare));
-		blockers = behindToPinned & bitboardPosition.occupied;
-		
-		// A piece exists in the region: pinned<->behind, so no pin!
-		if (blockers) { return kFalse; }
-		
-		// Obtain mask for region: rest of rank<->pinned
-		pinnedToPinner = (sskBitmapWithNorthEastDiagonal(pinnedSquare));
-		blockers = pinnedToPinner & bitboardPosition.occupied;
-		
-		// There is no piece to create a pin
-		if (blockers == 0) { return kFalse; }
-		
-		*pinCausingPieceSquare = sskFirstOneIndex(blockers);
-		pinner = offsetPosition[*pinCausingPieceSquare];
-		
-		// The blocker is the same color as of the pinned piece
-		if (SSK_GET_PIECE_COLOR(pinner) == color) { return kFalse; }
-		
-		if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceBishop || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-			return kTrue;
-		} else {
-			return kFalse;
-		}		
-	} else if ((pinnedFile < behindFile && pinnedRank > behindRank)
-			   && ((behindFile - pinnedFile) == (pinnedRank - behindRank))
-			   ) {	// Behind Square is in South West Diagonal
-		//printf("\n Behind Square SW Diagonal");
-		// Obtain mask for region: pinned<->behind and identify blockers there.
-		behindToPinned = (sskBitmapWithNorthWestDiagonal(pinnedSquare) ^ sskBitmapWithNorthWestDiagonal(behindSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(pinnedSquare));
-		blockers = behindToPinned & bitboardPosition.occupied;
-		
-		// A piece exists in the region: pinned<->behind, so no pin!
-		if (blockers) { return kFalse; }
-		
-		// Obtain mask for region: rest of rank<->pinned
-		pinnedToPinner = (sskBitmapWithNorthWestDiagonal(pinnedSquare));
-		blockers = pinnedToPinner & bitboardPosition.occupied;
-		
-		// There is no piece to create a pin
-		if (blockers == 0) { return kFalse; }
+		case sskChessPieceKnight: return sskBitmapWithKnightReach(fromSquare);
+		case sskChessPieceBishop: return sskBitmapWithBishopAttacks(fromSquare, occupied);
+		case sskChessPieceRook: return sskBitmapWithRookAttacks(fromSquare, occupied);
+		case sskChessPieceQueen: return sskBitmapWithQueenAttacks(fromSquare, occupied);
+		default: return SSK_EMPTY_BITMAP;
+	}
+}
+
+/**
+ *	Pawns that can legally capture en passant. The capture removes two pieces from a line through
+ *	the king at once, which pins do not cover, so the king's attackers are looked up again on the
+ *	occupancy after the capture. That also settles whether the capture resolves a check.
+ */
+static sskBitmap _sskBitmapWithEnPassantCapturers(const sskPosition * position, sskChessColor color, sskChessSquare kingSquare, sskChessSquare enPassantTarget) {
+	sskBitmap occupied = sskBitmapForOccupancyInPosition(position), pawns, capturers = SSK_EMPTY_BITMAP, afterOccupied;
+	sskChessSquare capturedPawnSquare, fromSquare;
+	
+	if (enPassantTarget == 0 || (occupied & SSK_BITMAP_SET_SQUARE_IDX(enPassantTarget))) return SSK_EMPTY_BITMAP;
+	
+	capturedPawnSquare = (color == sskChessColorWhite) ? enPassantTarget - 8 : enPassantTarget + 8;
+	if (sskPieceOnSquareInPosition(position, capturedPawnSquare) != ((!color << 3) | sskChessPiecePawn)) return SSK_EMPTY_BITMAP;
+	
+	pawns = sskBitmapWithPawnSetAttacks(SSK_BITMAP_SET_SQUARE_IDX(enPassantTarget), !color) & sskBitmapForPieceTypeInPosition(position, sskChessPiecePawn) & position->colors[color];
+	while (pawns) {
+		fromSquare = sskFirstOneIndex(pawns);
+		pawns &= SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
 		
-		*pinCausingPieceSquare = sskFirstOneIndex(blockers);
-		pinner = offsetPosition[*pinCausingPieceSquare];
+		afterOccupied = (occupied & SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(capturedPawnSquare)) | SSK_BITMAP_SET_SQUARE_IDX(enPassantTarget);
+		if (!(sskBitmapWithAttackersToInPosition(position, kingSquare, afterOccupied) & position->colors[!color] & afterOccupied)) {
+			capturers |= SSK_BITMAP_SET_SQUARE_IDX(fromSquare);
+		}
+	}
+	
+	return capturers;
+}
+
+/**
+ *	Verifies a castling of the side not under check, given the squares attacked by the opponent with
+ *	the king lifted. Fills the king's and rook's squares, which encode the move.
+ */
+static kBool _sskIsCastlingLegal(const sskPosition * position, sskChessColor color, const char castlingStatus[5], sskCastlingType castlingType, sskBitmap attackedSquares, sskChessSquare * kingSquare, sskChessSquare * rookSquare) {
+	sskChessSquare kingToSquare, rookToSquare;
+	sskBitmap afterOccupied;
+	
+	if (!_sskFillCastlingSquares(position, castlingStatus, castlingType, kingSquare, &kingToSquare, rookSquare, &rookToSquare)) return kFalse;
+	if (!_sskIsCastlingPathClear(position, color, *kingSquare, kingToSquare, *rookSquare, rookToSquare)) return kFalse;
+	if (sskBitmapWithCastlingKingPath(*kingSquare, kingToSquare) & attackedSquares) return kFalse;
+	
+	// In Chess960 the rook may have shielded the king's destination along the back rank.
+	afterOccupied = (sskBitmapForOccupancyInPosition(position) & SSK_BITMAP_UNSET_SQUARE_IDX(*kingSquare) & SSK_BITMAP_UNSET_SQUARE_IDX(*rookSquare)) |
+					SSK_BITMAP_SET_SQUARE_IDX(kingToSquare) | SSK_BITMAP_SET_SQUARE_IDX(rookToSquare);
+	return (sskBitmapWithAttackersToInPosition(position, kingToSquare, afterOccupied) & position->colors[!color]) ? kFalse : kTrue;
+}
+
+unsigned short sskGenerateLegalMoves(const sskPosition * position, const sskPositionState * state, sskEncodedMove buffer[SSK_MAX_LEGAL_MOVES]) {
+	sskChessColor color = state->sideToMove;
+	sskBitmap us = position->colors[color];
+	sskBitmap occupied = sskBitmapForOccupancyInPosition(position);
+	sskBitmap king = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & us;
+	sskBitmap pieces, targets, evasionSquares, pinnedPieces, attackedSquares;
+	sskChessSquare kingSquare, fromSquare, castlingKingSquare, castlingRookSquare;
+	sskChessPiece genericPiece;
+	unsigned short count = 0;
+	int slot;
+	
+	if (king == SSK_EMPTY_BITMAP) return 0;
+	kingSquare = sskFirstOneIndex(king);
+	
+	// King moves, to squares not attacked with the king lifted so sliders checking it see through.
+	attackedSquares = sskBitmapWithSquaresAttackedBySideInPosition(position, !color, occupied & ~king);
+	count = _sskAppendMoves(buffer, count, kingSquare, sskBitmapWithKingReach(kingSquare) & ~us & ~attackedSquares, kFalse);
+	
+	// On a double check only the king moves.
+	evasionSquares = sskBitmapWithCheckEvasionSquaresInPosition(position, color);
+	if (evasionSquares == SSK_EMPTY_BITMAP) return count;
+	
+	pinnedPieces = sskBitmapWithPinnedPiecesInPosition(position, color, NULL);
+	pieces = us & ~king;
+	while (pieces) {
+		fromSquare = sskFirstOneIndex(pieces);
+		pieces &= SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
+		genericPiece = SSK_GET_GENERIC_PIECE_CODE(sskPieceOnSquareInPosition(position, fromSquare));
 		
-		// The blocker is the same color as of the pinned piece
-		if (SSK_GET_PIECE_COLOR(pinner) == color) { return kFalse; }
+		targets = _sskBitmapWithPieceTargets(position, genericPiece, fromSquare, color, occupied) & ~us & evasionSquares & sskBitmapWithPinAllowedSquares(pinnedPieces, kingSquare, fromSquare);
+		count = _sskAppendMoves(buffer, count, fromSquare, targets, (genericPiece == sskChessPiecePawn));
+	}
+	
+	pieces = _sskBitmapWithEnPassantCapturers(position, color, kingSquare, state->enPassantTarget);
+	while (pieces) {
+		fromSquare = sskFirstOneIndex(pieces);
+		pieces &= SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
+		buffer[count++] = SSK_ENCODE_MOVE(fromSquare, state->enPassantTarget, sskEncodedMoveFlagEnPassant);
+	}
+	
+	// Castling, never out of a check.
+	if (evasionSquares == SSK_FULL_BITMAP) {
+		for (slot = 2 * color; slot < 2 * color + 2; slot++) {
+			if (_sskIsCastlingLegal(position, color, state->castlingStatus, (1 << slot), attackedSquares, &castlingKingSquare, &castlingRookSquare)) {
+				buffer[count++] = SSK_ENCODE_MOVE(castlingKingSquare, castlingRookSquare, sskEncodedMoveFlagCastling);
+			}
+		}
+	}
+	
+	return count;
+}
+
+kBool sskHasLegalMove(const sskPosition * position, const sskPositionState * state) {
+	sskChessColor color = state->sideToMove;
+	sskBitmap us = position->colors[color];
+	sskBitmap occupied = sskBitmapForOccupancyInPosition(position);
+	sskBitmap king = sskBitmapForPieceTypeInPosition(position, sskChessPieceKing) & us;
+	sskBitmap targets, evasionSquares, pinnedPieces, attackedSquares, movers, pieces, queens;
+	sskChessSquare kingSquare, fromSquare, castlingKingSquare, castlingRookSquare;
+	int slot;
+	
+	if (king == SSK_EMPTY_BITMAP) return kFalse;
+	kingSquare = sskFirstOneIndex(king);
+	
+	// The king stepping to an unattacked square is the likeliest move.
+	attackedSquares = sskBitmapWithSquaresAttackedBySideInPosition(position, !color, occupied & ~king);
+	if (sskBitmapWithKingReach(kingSquare) & ~us & ~attackedSquares) return kTrue;
+	
+	// On a double check only the king moves.
+	evasionSquares = sskBitmapWithCheckEvasionSquaresInPosition(position, color);
+	if (evasionSquares == SSK_EMPTY_BITMAP) return kFalse;
+	
+	// Pieces free of pins, set-wise: pawns, knights, then sliders.
+	pinnedPieces = sskBitmapWithPinnedPiecesInPosition(position, color, NULL);
+	movers = us & ~king & ~pinnedPieces;
+	pieces = sskBitmapForPieceTypeInPosition(position, sskChessPiecePawn) & movers;
+	queens = sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen) & movers;
+	
+	if ((sskBitmapWithPawnSetPushes(pieces, occupied, color) & evasionSquares) ||
+		(sskBitmapWithPawnSetAttacks(pieces, color) & position->colors[!color] & evasionSquares) ||
+		(sskBitmapWithKnightSetAttacks(sskBitmapForPieceTypeInPosition(position, sskChessPieceKnight) & movers) & ~us & evasionSquares) ||
+		(sskBitmapWithRookSetAttacks((sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) & movers) | queens, occupied) & ~us & evasionSquares) ||
+		(sskBitmapWithBishopSetAttacks((sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) & movers) | queens, occupied) & ~us & evasionSquares)) {
+		return kTrue;
+	}
+	
+	// Pinned pieces only move along their pin line, which a knight never does.
+	pieces = pinnedPieces & ~sskBitmapForPieceTypeInPosition(position, sskChessPieceKnight);
+	while (pieces) {
+		fromSquare = sskFirstOneIndex(pieces);
+		pieces &= SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
 		
-		if (SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceBishop || SSK_GET_GENERIC_PIECE_CODE(pinner) == sskChessPieceQueen) {
-			return kTrue;
+		targets = _sskBitmapWithPieceTargets(position, SSK_GET_GENERIC_PIECE_CODE(sskPieceOnSquareInPosition(position, fromSquare)), fromSquare, color, occupied);
+		if (targets & ~us & evasionSquares & sskBitmapWithLine(kingSquare, fromSquare)) return kTrue;
+	}
+	
+	if (_sskBitmapWithEnPassantCapturers(position, color, kingSquare, state->enPassantTarget)) return kTrue;
+	
+	// Castling, never out of a check.
+	if (evasionSquares == SSK_FULL_BITMAP) {
+		for (slot = 2 * color; slot < 2 * color + 2; slot++) {
+			if (_sskIsCastlingLegal(position, color, state->castlingStatus, (1 << slot), attackedSquares, &castlingKingSquare, &castlingRookSquare)) return kTrue;
+		}
+	}
+	
+	return kFalse;
+}
+
+void sskUnmakeMoveInPosition(sskPosition * position, const sskUndoRecord * undoRecord) {
+	_sskToggleMoveInPosition(position, undoRecord);
+	
+	position->mailbox[undoRecord->toSquare] = sskChessPieceNone;
+	if (undoRecord->rookFromSquare != undoRecord->rookToSquare) {
+		position->mailbox[undoRecord->rookToSquare] = sskChessPieceNone;
+		position->mailbox[undoRecord->rookFromSquare] = (SSK_GET_PIECE_COLOR(undoRecord->movedPiece) << 3) | sskChessPieceRook;
+	}
+	position->mailbox[undoRecord->fromSquare] = undoRecord->movedPiece;
+	if (undoRecord->capturedPiece != sskChessPieceNone) position->mailbox[undoRecord->capturedSquare] = undoRecord->capturedPiece;
+}
+
+unsigned short sskIsKingUnderCheckInPosition(const sskPosition * position, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare) {
+	sskBitmap checkers = sskBitmapWithCheckingPiecesInPosition(position, kingColor, shouldIncludeKing);
+	
+	if (checkers && checkingPieceSquare != NULL) *checkingPieceSquare = sskLastOneIndex(checkers);
+	
+	return sskCountBits(checkers);
+}
+
+unsigned short sskIsKingUnderCheckRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskIsKingUnderCheckInPosition(&position, kingColor, shouldIncludeKing, checkingPieceSquare);
+}
+
+unsigned short sskIsKingUnderCheck(sskBitboardPosition bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare) {
+	return sskIsKingUnderCheckRef(&bitboardPosition, kingColor, shouldIncludeKing, checkingPieceSquare);
+}
+
+sskBitmap sskBitmapWithCheckingPiecesInPosition(const sskPosition * position, sskChessColor kingColor, kBool shouldIncludeKing) {
+	return (kingColor == sskChessColorWhite)?_sskCheckingPiecesOnWhiteKing(position, shouldIncludeKing):_sskCheckingPiecesOnBlackKing(position, shouldIncludeKing);
+}
+
+sskBitmap sskBitmapWithCheckingPiecesRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapWithCheckingPiecesInPosition(&position, kingColor, shouldIncludeKing);
+}
+
+sskBitmap sskBitmapWithCheckingPieces(sskBitboardPosition bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing) {
+	return sskBitmapWithCheckingPiecesRef(&bitboardPosition, kingColor, shouldIncludeKing);
+}
+
+sskBitmap sskBitmapWithCheckEvasionSquaresInPosition(const sskPosition * position, sskChessColor kingColor) {
+	sskBitmap checkers = sskBitmapWithCheckingPiecesInPosition(position, kingColor, kFalse);
+	sskChessSquare kingSquare;
+	
+	if (checkers == SSK_EMPTY_BITMAP) return SSK_FULL_BITMAP;	// No check, no restriction
+	if (checkers & (checkers - 1)) return SSK_EMPTY_BITMAP;		// Double check, the king has to move
+	
+	// Squares between are only there for an aligned slider, none for a knight, pawn or contact check.
+	kingSquare = sskFirstOneIndex(sskBitmapForPieceInPosition(position, (kingColor << 3) | sskChessPieceKing));
+	return checkers | sskBitmapWithSquaresBetween(sskFirstOneIndex(checkers), kingSquare);
+}
+
+sskBitmap sskBitmapWithCheckEvasionSquaresRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskBitmapWithCheckEvasionSquaresInPosition(&position, kingColor);
+}
+
+sskBitmap sskBitmapWithCheckEvasionSquares(sskBitboardPosition bitboardPosition, sskChessColor kingColor) {
+	return sskBitmapWithCheckEvasionSquaresRef(&bitboardPosition, kingColor);
+}
+
+kBool sskIsKingUnderCheckMateInPosition(const sskPosition * position, sskChessColor kingColor, int numChecks, int enpassantTarget) {
+	sskBitmap evasionSquares, movers, pawns, queens, occupied;
+	sskChessSquare kingSquare;
+	
+	if (numChecks == 0) return kFalse;
+	
+	evasionSquares = sskBitmapWithCheckEvasionSquaresInPosition(position, kingColor);
+	if (evasionSquares == SSK_FULL_BITMAP) return kFalse;	// Not under check
+	
+	// Check if king has an escape square
+	if (sskCanKingEscapeInPosition(position, kingColor)) return kFalse;
+	
+	// Double check and king can't escape -> Checkmate
+	if (evasionSquares == SSK_EMPTY_BITMAP) return kTrue;
+	
+	// A single check is resolved by capturing the checker or blocking a square between it and the
+	// king, by a piece other than the king. A pinned piece can never resolve the check.
+	occupied = sskBitmapForOccupancyInPosition(position);
+	movers = position->colors[kingColor] & ~sskBitmapWithPinnedPiecesInPosition(position, kingColor, NULL);
+	pawns = sskBitmapForPieceTypeInPosition(position, sskChessPiecePawn) & movers;
+	queens = sskBitmapForPieceTypeInPosition(position, sskChessPieceQueen) & movers;
+	
+	if ((sskBitmapWithPawnSetAttacks(pawns, kingColor) & evasionSquares & position->colors[!kingColor]) ||
+		(sskBitmapWithPawnSetPushes(pawns, occupied, kingColor) & evasionSquares) ||
+		(sskBitmapWithKnightSetAttacks(sskBitmapForPieceTypeInPosition(position, sskChessPieceKnight) & movers) & evasionSquares) ||
+		(sskBitmapWithRookSetAttacks((sskBitmapForPieceTypeInPosition(position, sskChessPieceRook) & movers) | queens, occupied) & evasionSquares) ||
+		(sskBitmapWithBishopSetAttacks((sskBitmapForPieceTypeInPosition(position, sskChessPieceBishop) & movers) | queens, occupied) & evasionSquares)) {
+		return kFalse;
+	}
+	
+	// A double pushed pawn giving check can also be taken en passant, landing behind it. Removing
+	// both pawns can open a line to the king, so the capture is verified on the occupancy after it.
+	if (enpassantTarget > 0) {
+		kingSquare = sskFirstOneIndex(sskBitmapForPieceInPosition(position, (kingColor << 3) | sskChessPieceKing));
+		if (_sskBitmapWithEnPassantCapturers(position, kingColor, kingSquare, enpassantTarget)) return kFalse;
+	}
+	
+	return kTrue;
+}
+
+kBool sskIsKingUnderCheckMateRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, int numChecks, int enpassantTarget) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskIsKingUnderCheckMateInPosition(&position, kingColor, numChecks, enpassantTarget);
+}
+
+kBool sskIsKingUnderCheckMate(sskBitboardPosition bitboardPosition, sskChessColor kingColor, int numChecks, int enpassantTarget) {
+	return sskIsKingUnderCheckMateRef(&bitboardPosition, kingColor, numChecks, enpassantTarget);
+}
+
+kBool sskIsKingUnderStalemateInPosition(const sskPosition * position, sskChessColor kingColor, int enpassantTarget) {
+	sskPositionState state;
+	
+	// The castling status is not known here, the analyzer hands it to sskHasLegalMove() itself.
+	state.sideToMove = kingColor;
+	strcpy(state.castlingStatus, "----");
+	state.enPassantTarget = (enpassantTarget > 0) ? enpassantTarget : 0;
+	
+	return !sskHasLegalMove(position, &state);
+}
+
+kBool sskIsKingUnderStalemateRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, int enpassantTarget) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskIsKingUnderStalemateInPosition(&position, kingColor, enpassantTarget);
+}
+
+kBool sskIsKingUnderStalemate(sskBitboardPosition bitboardPosition, sskChessColor kingColor, int enpassantTarget) {
+	return sskIsKingUnderStalemateRef(&bitboardPosition, kingColor, enpassantTarget);
+}
+
+kBool sskCanKingEscapeInPosition(const sskPosition * position, sskChessColor kingColor) {
+	return (kingColor == sskChessColorWhite)?_sskCanWhiteKingEscape(position):_sskCanBlackKingEscape(position);
+}
+
+kBool sskCanKingEscapeRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskCanKingEscapeInPosition(&position, kingColor);
+}
+
+kBool sskCanKingEscape(sskBitboardPosition bitboardPosition, sskChessColor kingColor) {
+	return sskCanKingEscapeRef(&bitboardPosition, kingColor);
+}
+
+kBool sskIsSquareReachableInPosition(const sskPosition * position, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap) {
+	sskChessPiece pieceWithColor = sskPieceOnSquareInPosition(position, fromSquare);
+	sskChessPiece piece = SSK_GET_GENERIC_PIECE_CODE(pieceWithColor);
+	sskChessColor color = SSK_GET_PIECE_COLOR(pieceWithColor);
+    sskBitmap attacks = SSK_EMPTY_BITMAP;
+	
+	// No piece exists on fromSquare
+	if (piece == sskChessPieceNone) return kFalse;
+    
+	// Same color piece exists on toSquare or castling - reject
+	if (position->colors[color] & SSK_BITMAP_SET_SQUARE_IDX(toSquare)) {
+		// Castling as special case
+		if ((fromSquare == toSquare) &&
+			(piece == sskChessPieceKing) &&
+			(isCastlingOrEnpassantTarget != -1)) {
+			// continue execution
+		} else if(SSK_GET_FILE_IDX(toSquare) == isCastlingOrEnpassantTarget) {
+			// continue execution
 		} else {
 			return kFalse;
 		}
 	}
 	
+	attacks = sskBitmapForSpecificPieceAttacksInPosition(position, pieceWithColor, fromSquare, toSquare, isCastlingOrEnpassantTarget);
+	
+    if(attackMap != NULL) *attackMap = attacks;
+	if (attacks & SSK_BITMAP_SET_SQUARE_IDX(toSquare)) return kTrue;
+	
 	return kFalse;
 }
 
+kBool sskIsSquareReachableRef(const sskBitboardPosition * bitboardPosition, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskIsSquareReachableInPosition(&position, fromSquare, toSquare, isCastlingOrEnpassantTarget, attackMap);
+}
+
+kBool sskIsSquareReachable(sskBitboardPosition bitboardPosition, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap) {
+	return sskIsSquareReachableRef(&bitboardPosition, fromSquare, toSquare, isCastlingOrEnpassantTarget, attackMap);
+}
+
+
+kBool sskIsSquarePinnedInPosition(const sskPosition * position, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare) {
+	return (color == sskChessColorWhite)?_sskIsWhiteSquarePinned(position, pinnedSquare, behindSquare, pinCausingPieceSquare):_sskIsBlackSquarePinned(position, pinnedSquare, behindSquare, pinCausingPieceSquare);
+}
+
+kBool sskIsSquarePinnedRef(const sskBitboardPosition * bitboardPosition, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare) {
+	sskPosition position;
+	sskBitboardPositionToPosition(bitboardPosition, &position);
+	return sskIsSquarePinnedInPosition(&position, pinnedSquare, behindSquare, color, pinCausingPieceSquare);
+}
+
+kBool sskIsSquarePinned(sskBitboardPosition bitboardPosition, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare) {
+	return sskIsSquarePinnedRef(&bitboardPosition, pinnedSquare, behindSquare, color, pinCausingPieceSquare);
+}
+
 sskSquareCommonality sskGetSquareCommonality(sskChessSquare squares[], int numSquares) {
 	if (numSquares <= 1) return sskSquareCommonalityNone;
 	
@@ -1086,150 +1505,98 @@ sskSquareCommonality sskGetSquareCommonality(sskChessSquare squares[], int numSq
 	return commonality;
 }
 
+/** Bitmap with the given squares set. */
+static sskBitmap _sskBitmapWithSquares(const sskChessSquare squares[], unsigned short numSquares) {
+	sskBitmap bitmap = SSK_EMPTY_BITMAP;
+	int i;
+	
+	for (i = 0; i < numSquares; i++) {
+		bitmap |= SSK_BITMAP_SET_SQUARE_IDX(squares[i]);
+	}
+	
+	return bitmap;
+}
+
 kBool sskCheckMoveAmbiguityAndFillFromSquare(sskOffsetPosition offsetPosition, sskChessSquare reachablePiecesFromSquares[], unsigned short numReachablePieces, sskMove * move) {
+	(void)offsetPosition;
 	if (numReachablePieces == 0) return kFalse;
+	return sskCheckMoveAmbiguityAndFillFromSquareWithOrigins(_sskBitmapWithSquares(reachablePiecesFromSquares, numReachablePieces), move);
+}
+
+kBool sskCheckMoveAmbiguityAndFillFromSquareInPosition(const sskPosition * position, sskChessSquare reachablePiecesFromSquares[], unsigned short numReachablePieces, sskMove * move) {
+	(void)position;
+	if (numReachablePieces == 0) return kFalse;
+	return sskCheckMoveAmbiguityAndFillFromSquareWithOrigins(_sskBitmapWithSquares(reachablePiecesFromSquares, numReachablePieces), move);
+}
+
+sskBitmap sskBitmapWithMoveOriginsInPosition(const sskPosition * position, const sskMove * move) {
+	sskChessColor color = SSK_GET_PIECE_COLOR(move->pieceMoved);
+	sskBitmap pieces = sskBitmapForPieceInPosition(position, move->pieceMoved);
+	sskBitmap occupied = sskBitmapForOccupancyInPosition(position);
+	sskBitmap target = SSK_BITMAP_SET_SQUARE_IDX(move->toSquare), origins, pinnedOrigins;
+	sskChessSquare kingSquare, fromSquare;
 	
-	kBool ambiguity = kFalse;
-	int i;
-    
-	if (numReachablePieces == 1) { // If any extra information was extracted, make sure it is relevant.
-		switch (move->fromSquareExtracted) {
-			case sskChessSquareInfoFileOnly: {
-				if (SSK_GET_FILE_IDX(move->fromSquare) != SSK_GET_FILE_IDX(reachablePiecesFromSquares[0])) {
-					ambiguity = kTrue; // Check if the extracted file is indeed the calculated fromSquare
-				}
-				break;
-			}
-			case sskChessSquareInfoRankOnly: {
-				if (SSK_GET_RANK_IDX(move->fromSquare) != SSK_GET_RANK_IDX(reachablePiecesFromSquares[0])) {
-					ambiguity = kTrue; // Check if the extracted file is indeed the calculated fromSquare
-				}
-				break;
+	if (position->colors[color] & target) return SSK_EMPTY_BITMAP;
+	
+	// The piece's moves reversed: whatever such a piece on toSquare would attack can come from there.
+	switch (SSK_GET_GENERIC_PIECE_CODE(move->pieceMoved)) {
+		case sskChessPiecePawn: {
+			origins = SSK_EMPTY_BITMAP;
+			
+			// Captures land on an opponent piece or the en passant target.
+			if ((position->colors[!color] & target) ||
+				(move->enPassantTarget != 0 && move->toSquare == move->enPassantTarget && SSK_GET_RANK_IDX(move->toSquare) == ((color == sskChessColorWhite) ? 5 : 2))) {
+				origins = sskBitmapWithPawnSetAttacks(target, !color) & pieces;
 			}
-			case sskChessSquareInfoFileAndRank: {
-				if (move->fromSquare != reachablePiecesFromSquares[0]) {
-					ambiguity = kTrue; // Check if the extracted fromSquare is same as the calculated fromSquare
+			
+			// Pushes land on an empty square, from one square back or two over an empty square.
+			if (!(occupied & target)) {
+				if (color == sskChessColorWhite) {
+					origins |= ((target >> 8) | ((((target >> 8) & ~occupied) >> 8) & sskBitmapWithRankMask(1))) & pieces;
+				} else {
+					origins |= ((target << 8) | ((((target << 8) & ~occupied) << 8) & sskBitmapWithRankMask(6))) & pieces;
 				}
-				break;
 			}
-			case sskChessSquareInfoNone:
-			default:
-				break;
+			break;
 		}
-		move->fromSquare = reachablePiecesFromSquares[0];
-	} else if (numReachablePieces >= 2) {
-		sskChessSquareInfo squareCommonality = sskGetSquareCommonality(reachablePiecesFromSquares, numReachablePieces);
-		
-		if(squareCommonality == sskSquareCommonalityNone) {
-			// Check for information extracted by the lexical analyzer to resolve ambiguity.
-			switch (move->fromSquareExtracted) {
-				case sskChessSquareInfoNone: {
-					ambiguity = kTrue;
-					break;
-				}
-					
-				case sskChessSquareInfoFileOnly: {
-					// Find the piece on the particular file.
-					for (i = 0; i < numReachablePieces; i++) {
-						if (SSK_GET_FILE_IDX(reachablePiecesFromSquares[i]) == SSK_GET_FILE_IDX(move->fromSquare)) {
-							move->fromSquare = reachablePiecesFromSquares[i];
-							break;
-						}
-					}
-					// No piece was found!
-					if (i == numReachablePieces) { ambiguity = kTrue; }
-					break;
-				}
-					
-				case sskChessSquareInfoRankOnly: {
-					// Find the piece on the particular rank.
-					for (i = 0; i < numReachablePieces; i++) {
-						if (SSK_GET_RANK_IDX(reachablePiecesFromSquares[i]) == SSK_GET_RANK_IDX(move->fromSquare)) {
-							move->fromSquare = reachablePiecesFromSquares[i];
-							break;
-						}
-					}
-					// No piece was found!
-					if (i == numReachablePieces) { ambiguity = kTrue; }
-					break;
-				}
-					
-				case sskChessSquareInfoFileAndRank: {
-					// Lookup to find if the piece exists on the given square
-					if (offsetPosition[move->fromSquare] != move->pieceMoved) {
-						ambiguity = kTrue;
-					}
-					break;
-				}
-			}
-		} else if((squareCommonality & sskSquareCommonalityFile) && (squareCommonality & sskSquareCommonalityRank)) {
-			if (move->fromSquareExtracted == sskChessSquareInfoFileAndRank) {
-				if (offsetPosition[move->fromSquare] != move->pieceMoved) {
-					ambiguity = kTrue;
-				}
-			} else {
-				ambiguity = kTrue;
-			}
-		} else if(squareCommonality & sskSquareCommonalityFile) {
-			// Check for information extracted by the lexical analyzer to resolve ambiguity.
-			switch (move->fromSquareExtracted) {
-				case sskChessSquareInfoNone:
-				case sskChessSquareInfoFileOnly: {
-					ambiguity = kTrue;
-					break;
-				}
-				case sskChessSquareInfoRankOnly: {
-					// Find the piece on the particular rank.
-					for (i = 0; i < numReachablePieces; i++) {
-						if (SSK_GET_RANK_IDX(reachablePiecesFromSquares[i]) == SSK_GET_RANK_IDX(move->fromSquare)) {
-							move->fromSquare = reachablePiecesFromSquares[i];
-							break;
-						}
-					}
-					// No piece was found!
-					if (i == numReachablePieces) { ambiguity = kTrue; }
-					break;
-				}
-					
-				case sskChessSquareInfoFileAndRank: {
-					// Lookup to find if the piece exists on the given square
-					if (offsetPosition[move->fromSquare] != move->pieceMoved) {
-						ambiguity = kTrue;
-					}
-					break;
-				}
-			}
-		} else if(squareCommonality & sskSquareCommonalityRank) {
-			// Check for information extracted by the lexical analyzer to resolve ambiguity.
-			switch (move->fromSquareExtracted) {
-				case sskChessSquareInfoNone:
-				case sskChessSquareInfoRankOnly: {
-					ambiguity = kTrue;
-					break;
-				}
-				case sskChessSquareInfoFileOnly: {
-					// Find the piece on the particular file.
-					for (i = 0; i < numReachablePieces; i++) {
-						if (SSK_GET_FILE_IDX(reachablePiecesFromSquares[i]) == SSK_GET_FILE_IDX(move->fromSquare)) {
-							move->fromSquare = reachablePiecesFromSquares[i];
-							break;
-						}
-					}
-					// No piece was found!
-					if (i == numReachablePieces) { ambiguity = kTrue; }
-					break;
-				}
-					
-				case sskChessSquareInfoFileAndRank: {
-					// Lookup to find if the piece exists on the given square
-					if (offsetPosition[move->fromSquare] != move->pieceMoved) {
-						ambiguity = kTrue;
-					}
-					break;
-				}
-			}
+		case sskChessPieceKnight: origins = sskBitmapWithKnightReach(move->toSquare) & pieces; break;
+		case sskChessPieceBishop: origins = sskBitmapWithBishopAttacks(move->toSquare, occupied) & pieces; break;
+		case sskChessPieceRook: origins = sskBitmapWithRookAttacks(move->toSquare, occupied) & pieces; break;
+		case sskChessPieceQueen: origins = sskBitmapWithQueenAttacks(move->toSquare, occupied) & pieces; break;
+		case sskChessPieceKing: return sskBitmapWithKingReach(move->toSquare) & pieces;	// A king is never pinned
+		default: return SSK_EMPTY_BITMAP;
+	}
+	
+	if (origins == SSK_EMPTY_BITMAP) return SSK_EMPTY_BITMAP;
+	
+	// A pinned piece stays only if toSquare lies on its pin line, capturing the pinner or maintaining the pin.
+	pinnedOrigins = sskBitmapWithPinnedPiecesInPosition(position, color, NULL) & origins;
+	if (pinnedOrigins) {
+		kingSquare = sskFirstOneIndex(sskBitmapForPieceInPosition(position, (color << 3) | sskChessPieceKing));
+		while (pinnedOrigins) {
+			fromSquare = sskFirstOneIndex(pinnedOrigins);
+			pinnedOrigins &= SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
+			if (!(sskBitmapWithLine(kingSquare, fromSquare) & target)) origins &= SSK_BITMAP_UNSET_SQUARE_IDX(fromSquare);
 		}
 	}
 	
-	return ambiguity;
-}
\ No newline at end of file
+	return origins;
+}
+
+kBool sskCheckMoveAmbiguityAndFillFromSquareWithOrigins(sskBitmap origins, sskMove * move) {
+	// Keep the origins matching the file, rank or square extracted by the lexical analyzer.
+	switch (move->fromSquareExtracted) {
+		case sskChessSquareInfoFileOnly: origins &= sskBitmapWithFileMask(SSK_GET_FILE_IDX(move->fromSquare)); break;
+		case sskChessSquareInfoRankOnly: origins &= sskBitmapWithRankMask(SSK_GET_RANK_IDX(move->fromSquare)); break;
+		case sskChessSquareInfoFileAndRank: origins &= SSK_BITMAP_SET_SQUARE_IDX(move->fromSquare); break;
+		case sskChessSquareInfoNone:
+		default:
+			break;
+	}
+	
+	// Exactly one origin has to remain.
+	if (origins == SSK_EMPTY_BITMAP || (origins & (origins - 1))) return kTrue;
+	
+	move->fromSquare = sskFirstOneIndex(origins);
+	return kFalse;
+}
@@ -30,6 +30,31 @@ enum {
 };
 typedef unsigned short sskSemanticAnalyzerError;		/** Custom typedef for semantic analysis error code */
 
+/**
+ *	Enum defines the option flags for the sskSemanticAnalyzeWithOptions() function.
+ */
+enum {
+	sskSemanticAnalyzerOptionNone = 0,									/** Every output is computed, draws by rule are only flagged on the moves */
+	sskSemanticAnalyzerOptionRejectMovesAfterAutomaticDraw = (1 << 0),	/** Moves after a fivefold repetition or the 75-move rule are an error */
+	sskSemanticAnalyzerOptionSkipPlacements = (1 << 1),					/** The piece placement strings are not filled */
+	sskSemanticAnalyzerOptionSkipGameEnd = (1 << 2),					/** No checkmate, stalemate, draw by rule or dead position detection, nor the keys it needs */
+	sskSemanticAnalyzerOptionSkipChecks = (1 << 3)						/** The king status is not filled, only honoured with sskSemanticAnalyzerOptionSkipGameEnd */
+};
+typedef unsigned int sskSemanticAnalyzerOptions;		/** Bitwise OR of sskSemanticAnalyzerOption flags */
+
+/**
+ *	Analysis levels, each computing the outputs of the one below it and more. Moves are always
+ *	verified and completed: from and to squares, captures, castling status, en passant target and
+ *	halfmove clock. Without the game end outputs a move after checkmate or stalemate is reported
+ *	as sskSemanticAnalyzerErrorIllegalMove.
+ */
+enum {
+	sskSemanticAnalyzerLevelLegality = (sskSemanticAnalyzerOptionSkipPlacements | sskSemanticAnalyzerOptionSkipGameEnd | sskSemanticAnalyzerOptionSkipChecks),	/** Legality and move completion only */
+	sskSemanticAnalyzerLevelChecks = (sskSemanticAnalyzerOptionSkipPlacements | sskSemanticAnalyzerOptionSkipGameEnd),	/** Plus the check flags of the king status */
+	sskSemanticAnalyzerLevelGameEnd = (sskSemanticAnalyzerOptionSkipPlacements),	/** Plus checkmate, stalemate, draws by rule and the position and material keys */
+	sskSemanticAnalyzerLevelFull = (sskSemanticAnalyzerOptionNone)					/** Plus the piece placement strings */
+};
+
 /**
  *	Function analyses the given move list for semantic correctness 
  *	and completes the fromSquare-toSquare pair. If the ambiguity
@@ -49,13 +74,31 @@ typedef unsigned short sskSemanticAnalyzerError;		/** Custom typedef for semanti
  */
 sskSemanticAnalyzerError sskSemanticAnalyze(sskMoveList moveList, char * startingPosition, int * ambiguousHalfmoveNumber);
 
+/**
+ *	Function analyses the given move list like sskSemanticAnalyze(), with option flags. Every
+ *	move gets the repetition count and draw status of the position after it, repetitions are
+ *	found by comparing position keys back to the last pawn move or capture only. The skip flags,
+ *	usually combined as one of the sskSemanticAnalyzerLevel values, leave out outputs and the
+ *	work they take.
+ *
+ *	@param moveList The input move list.
+ *	@param startingPosition The starting position, specified as an xFEN string.
+ *	@param options Bitwise OR of sskSemanticAnalyzerOption flags.
+ *	@param ambiguousHalfmoveNumber Out parameter, filled if a move was found ambigous. (optional, can be NULL)
+ *
+ *	@return Returns the error code, as sskSemanticAnalyze(). With
+ *		sskSemanticAnalyzerOptionRejectMovesAfterAutomaticDraw moves after a fivefold repetition or
+ *		the 75-move rule return sskSemanticAnalyzerErrorMovesExistAfterGameEnd.
+ */
+sskSemanticAnalyzerError sskSemanticAnalyzeWithOptions(sskMoveList moveList, char * startingPosition, sskSemanticAnalyzerOptions options, int * ambiguousHalfmoveNumber);
+
 /**
  *	Function verifies if the move is pseudo legal and returns
  *	the fromSquare variable of the given move. Additionaly it fills
  *	fromSquare and other information it discovers during analysis.
  *
  *	@param bitboardPosition The current position in bitboard format.
- *	@param offsetPosition The current position in offset format.
+ *	@param offsetPosition Unused, pieces are looked up in bitboardPosition. Kept for compatibility.
  *	@param move A pointer to the move to be checked.
  *	@param ambiguity Out variable filled with kTrue if ambiguity was found.
  *
@@ -63,6 +106,12 @@ sskSemanticAnalyzerError sskSemanticAnalyze(sskMoveList moveList, char * startin
  */
 kBool sskFillFromSquare(sskBitboardPosition bitboardPosition, sskOffsetPosition offsetPosition, sskMove * move, kBool * ambiguity);
 
+/** Const pointer variant of sskFillFromSquare(). offsetPosition is ignored as well, it is only kept for compatibility. */
+kBool sskFillFromSquareRef(const sskBitboardPosition * bitboardPosition, sskOffsetPosition offsetPosition, sskMove * move, kBool * ambiguity);
+
+/** Compact position variant of sskFillFromSquare(), pieces are looked up in the position's mailbox. */
+kBool sskFillFromSquareInPosition(const sskPosition * position, sskMove * move, kBool * ambiguity);
+
 /**
  *  Function verifies if the move is completely legal, i.e) whether the move puts
  *  the king under check. Note that the given move should be complete in the sense that
@@ -78,6 +127,367 @@ kBool sskFillFromSquare(sskBitboardPosition bitboardPosition, sskOffsetPosition
  */
 sskBitboardPosition * sskCheckLegal(sskBitboardPosition bitboardPosition, sskMove * move, kBool moveWasPseudoLegalChecked);
 
+/** Const pointer variant of sskCheckLegal(). */
+sskBitboardPosition * sskCheckLegalRef(const sskBitboardPosition * bitboardPosition, sskMove * move, kBool moveWasPseudoLegalChecked);
+
+/**
+ *	Compact position variant of sskCheckLegal(). Instead of allocating the updated position
+ *	it is written to resultingPosition.
+ *
+ *	@param position The current position in compact format.
+ *	@param move A pointer to the move to be verified.
+ *	@param moveWasPseudoLegalChecked Set to true if the move's pseudo legallity was checked beforehand.
+ *	@param resultingPosition Out param, can be NULL. Filled with the position after the move if legal.
+ *
+ *	@return kTrue if the move is legal, else kFalse.
+ */
+kBool sskCheckLegalInPosition(const sskPosition * position, sskMove * move, kBool moveWasPseudoLegalChecked, sskPosition * resultingPosition);
+
+#pragma mark - Incremental analysis functions
+
+/** Capacity of the position key ring used for repetition detection, a power of two above 150 plies. */
+#define SSK_KEY_HISTORY_SIZE 256
+
+/**
+ *	The state of a game after its last analysed move, from which the analysis resumes when more
+ *	moves come: the position and its keys, castling rights, repetition history and the status the
+ *	next move starts with. Every analysis continues it, so a move costs the same however long
+ *	the game already is. It holds an sskPosition and is cache line aligned like it, on the heap
+ *	allocate it with posix_memalign() or aligned_alloc(), not malloc().
+ */
+typedef struct _sskGameState {
+	// Position after the last analysed move.
+	sskPosition					position;			/** The current position. */
+	sskZobristKey				piecesKey;			/** Zobrist key of the pieces of the position. */
+	sskMaterialKey				materialKey;		/** Piece counts of the position. */
+	sskMaterialClass			materialClass;		/** Classification of the piece counts. */
+	
+	// Status of the next move, as the move list carries it.
+	sskChessColor				sideToMove;			/** Color of the side to move. */
+	unsigned int				halfmove;			/** Halfmove number of the next move, 0 after init. Can be set for a later start. */
+	char						castlingStatus[5];	/** xFEN castling status, "KQkq" order with '-' for a lost right. */
+	sskChessSquare				enPassantTarget;	/** En passant target square, 0 for none. */
+	unsigned short				pawnHalfMoves;		/** Halfmoves since the last pawn move or capture. */
+	sskKingStatus				kingStatus;			/** Status of the king of the side to move, if didUpdateKingStatus. */
+	kBool						didUpdateKingStatus;	/** Indicates whether kingStatus was computed. */
+	kBool						hasMoveStatus;		/** kFalse after a null move, the next move then carries its own status. */
+	
+	// Castling rights with the rook files they were granted for and the rights each square keeps.
+	sskCastlingRights			castlingRights;
+	sskCastlingRights			castlingRightsUpdateMasks[64];
+	char						castlingFiles[5];
+	kBool						shouldLoadCastlingRights;	/** The rights are loaded from the status of the next move. */
+	
+	// Position keys since the last pawn move or capture. A ring, the oldest keys are only
+	// overwritten past the 150 plies of the 75-move rule.
+	sskZobristKey				keyHistory[SSK_KEY_HISTORY_SIZE];
+	unsigned int				historyTop;			/** Index of the key of the current position. */
+	unsigned int				reversiblePlies;	/** Plies since the last pawn move or capture. */
+	kBool						shouldSeedKeyHistory;	/** The history restarts at the next move. */
+	kBool						isDrawnByRule;		/** A fivefold repetition or the 75-move rule drew the game. */
+	
+	// The game so far and the results of its analysis.
+	sskSemanticAnalyzerOptions	options;			/** Bitwise OR of sskSemanticAnalyzerOption flags, for every move. */
+	sskMoveList					moveList;			/** Head of the game's moves, owned by the caller. */
+	sskMove *					lastMove;			/** Last move of the game, new moves are linked after it. */
+	sskSemanticAnalyzerError	error;				/** First error of the game, no move is analysed past it. */
+	int							ambiguousHalfmoveNumber;	/** Halfmove of the ambiguous move, -1 if none. */
+} sskGameState;
+
+/**
+ *	Function sets up a game state at a start position, with no moves yet. A missing position
+ *	is recorded as the game's error.
+ *
+ *	@param gameState The game state to set up.
+ *	@param startingPosition The starting position, specified as an xFEN string.
+ *	@param sideToMove The color of the side to move first.
+ *	@param castlingStatus The castling status of the position, "KQkq" order with '-' for a lost right.
+ *	@param options Bitwise OR of sskSemanticAnalyzerOption flags, used for every move of the game.
+ */
+void sskInitGameState(sskGameState * gameState, const char * startingPosition, sskChessColor sideToMove, const char castlingStatus[5], sskSemanticAnalyzerOptions options);
+
+/**
+ *	Function analyses moves continuing a game and links them after its last move. Only the new
+ *	moves are looked at, the first one gets the castling status, en passant target, halfmove clock
+ *	and king status the game left. Once a game has an error its moves are no longer analysed and
+ *	the list is left to the caller.
+ *
+ *	@param gameState The game state to continue.
+ *	@param moveList The moves to add, usually lexed from the game state's halfmove and side to move.
+ *
+ *	@return Returns the error code of the game, as sskSemanticAnalyzeWithOptions().
+ */
+sskSemanticAnalyzerError sskAnalyzeMovesInGameState(sskGameState * gameState, sskMoveList moveList);
+
+/**
+ *	Function lexes sSAN moves from the game state's halfmove and side to move, then analyses them
+ *	with sskAnalyzeMovesInGameState().
+ *
+ *	@param gameState The game state to continue.
+ *	@param input The moves in sSAN, separated by spaces.
+ *	@param errorIndex Out param, index of the lexical error in input or -1.
+ *
+ *	@return Returns the error code of the game, sskSemanticAnalyzerErrorProvidedMoveListEmpty if
+ *		the input has no moves or does not lex. The game state is then unchanged.
+ */
+sskSemanticAnalyzerError sskAppendMovesToGameState(sskGameState * gameState, char * input, int * errorIndex);
+
+#pragma mark - Parallel analysis functions
+
+/** Set to 0 where POSIX threads are unavailable, sskSemanticAnalyzeInParallel() then runs on the calling thread. */
+#ifndef SSK_USE_PTHREADS
+#define SSK_USE_PTHREADS (1)
+#endif
+
+/** Most threads sskSemanticAnalyzeInParallel() uses, the calling one included. */
+#ifndef SSK_MAX_ANNOTATION_THREADS
+#define SSK_MAX_ANNOTATION_THREADS 64
+#endif
+
+/** Fewest plies worth a thread of their own, shorter games use fewer threads. */
+#ifndef SSK_MIN_PLIES_PER_THREAD
+#define SSK_MIN_PLIES_PER_THREAD 32
+#endif
+
+/**
+ *	Function analyses the given move list like sskSemanticAnalyzeWithOptions(), in two passes. A
+ *	sequential replay verifies and completes the moves, tracks castling, en passant, clocks and
+ *	repetitions and records the positions around each move. Ranges of the recorded moves are then
+ *	annotated on up to numThreads threads with the king status, checkmate and stalemate included,
+ *	and the piece placements. Worth it for long games only, it allocates the recorded positions,
+ *	two compact positions a move. Moves past an error may be partly filled.
+ *
+ *	@param moveList The input move list.
+ *	@param startingPosition The starting position, specified as an xFEN string.
+ *	@param options Bitwise OR of sskSemanticAnalyzerOption flags.
+ *	@param numThreads Number of threads to annotate on, the calling one included.
+ *	@param ambiguousHalfmoveNumber Out parameter, filled if a move was found ambigous. (optional, can be NULL)
+ *
+ *	@return Returns the error code, as sskSemanticAnalyzeWithOptions().
+ */
+sskSemanticAnalyzerError sskSemanticAnalyzeInParallel(sskMoveList moveList, char * startingPosition, sskSemanticAnalyzerOptions options, unsigned int numThreads, int * ambiguousHalfmoveNumber);
+
+#pragma mark - Analyzer context functions
+
+/** Number of start positions an analyzer context keeps parsed. */
+#ifndef SSK_ANALYZER_CACHE_SIZE
+#define SSK_ANALYZER_CACHE_SIZE 8
+#endif
+
+/** Longest xFEN piece placement kept in the start position cache, 64 squares and 7 separators. */
+#define SSK_MAX_PIECE_PLACEMENT_LENGTH 71
+
+/**
+ *	A start position parsed once and kept in an analyzer context, with the keys derived from it.
+ */
+typedef struct _sskStartPositionCacheEntry {
+	sskPosition			position;		/** The parsed position. */
+	sskZobristKey		piecesKey;		/** Zobrist key of the pieces of the position. */
+	sskMaterialKey		materialKey;	/** Piece counts of the position. */
+	char				piecePlacement[SSK_MAX_PIECE_PLACEMENT_LENGTH + 1];	/** xFEN piece placement the entry was parsed from, the cache key. */
+} sskStartPositionCacheEntry;
+
+/**
+ *	Everything the semantic analysis needs besides the move list: the start position cache, the
+ *	scratch state of a game and the results of the last analysis. A context is set up once with
+ *	sskInitAnalyzerContext() and reused for any number of games, no game allocates. Usually it
+ *	lives on the stack or in a static, one per thread. It is cache line aligned, on the heap
+ *	allocate it with posix_memalign() or aligned_alloc(), not malloc().
+ */
+typedef struct _sskAnalyzerContext {
+	// Start positions by xFEN piece placement, the least recently added one is replaced when full.
+	sskStartPositionCacheEntry	startPositions[SSK_ANALYZER_CACHE_SIZE];
+	unsigned short				numStartPositions;		/** Number of filled cache entries. */
+	unsigned short				nextStartPosition;		/** Entry replaced by the next miss once the cache is full. */
+	unsigned short				lastStartPosition;		/** Entry of the last hit, tried first. */
+	
+	// Scratch state of the game being analysed.
+	sskGameState				gameState;		/** The game, its position and repetition history. */
+	
+	// Results of the last analysis, cleared by sskResetAnalyzerContext().
+	sskSemanticAnalyzerError	error;						/** Error code of the last analysis. */
+	int							ambiguousHalfmoveNumber;	/** Halfmove of the ambiguous move, -1 if none. */
+} sskAnalyzerContext;
+
+/**
+ *	Function sets up an analyzer context: empties the start position cache and clears the results.
+ *	It also builds the sliding attack tables, so that the analysis itself never has to.
+ *
+ *	@param context The context to set up.
+ */
+void sskInitAnalyzerContext(sskAnalyzerContext * context);
+
+/**
+ *	Function clears the results of the last analysis of a context. The start position cache is kept,
+ *	so the call costs the same whatever the number of games analysed before.
+ *
+ *	@param context The context to reset.
+ */
+void sskResetAnalyzerContext(sskAnalyzerContext * context);
+
+/**
+ *	Function analyses the given move list like sskSemanticAnalyzeWithOptions(), with the scratch state
+ *	of the given context. The start position is parsed only the first time its piece placement is
+ *	seen, later games starting from it copy the cached position and keys. The context is reset first
+ *	and its error and ambiguousHalfmoveNumber fields are filled.
+ *
+ *	@param context The context set up with sskInitAnalyzerContext().
+ *	@param moveList The input move list.
+ *	@param startingPosition The starting position, specified as an xFEN string.
+ *	@param options Bitwise OR of sskSemanticAnalyzerOption flags.
+ *
+ *	@return Returns the error code, as sskSemanticAnalyzeWithOptions().
+ */
+sskSemanticAnalyzerError sskSemanticAnalyzeInContext(sskAnalyzerContext * context, sskMoveList moveList, const char * startingPosition, sskSemanticAnalyzerOptions options);
+
+#pragma mark - Move making functions
+
+/**
+ *	Records what a move changed in a compact position. It is filled by sskMakeMoveInPosition()
+ *	and lets sskUnmakeMoveInPosition() restore the position without a copy.
+ */
+typedef struct _sskUndoRecord {
+	sskChessPiece		movedPiece;		/** 4-bit code of the piece that moved. */
+	sskChessPiece		capturedPiece;	/** 4-bit code of the captured piece or sskChessPieceNone. */
+	sskChessPiece		promotedPiece;	/** 3-bit code of the piece promoted to or sskChessPieceNone. */
+	sskChessSquare		fromSquare;		/** Square the piece moved from. */
+	sskChessSquare		toSquare;		/** Square the piece moved to. */
+	sskChessSquare		capturedSquare;	/** Square of the captured piece, differs from toSquare on en passant. */
+	sskChessSquare		rookFromSquare;	/** Square of the castling rook before the move. */
+	sskChessSquare		rookToSquare;	/** Square of the castling rook after the move, same as rookFromSquare if none moved. */
+} sskUndoRecord;
+
+/**
+ *	Function plays a move on a compact position by toggling the from/to bits of the moving piece
+ *	and, where they apply, those of the captured piece, the castling rook, the en passant victim and
+ *	the promoted piece. The move must be complete(fromSquare, toSquare, castlingType, castlingStatus,
+ *	enPassantTarget and promotedPiece filled) and pseudo legal, the function does not verify it.
+ *
+ *	@param position The position to update.
+ *	@param move The move to play.
+ *	@param undoRecord Out param, filled with what is needed to take the move back.
+ */
+void sskMakeMoveInPosition(sskPosition * position, const sskMove * move, sskUndoRecord * undoRecord);
+
+/**
+ *	Function takes back a move played by sskMakeMoveInPosition(). Moves have to be taken back
+ *	in the reverse order of playing them.
+ *
+ *	@param position The position to restore.
+ *	@param undoRecord The record filled when the move was played.
+ */
+void sskUnmakeMoveInPosition(sskPosition * position, const sskUndoRecord * undoRecord);
+
+/**
+ *	Function returns the change a played move makes to the piece part of a Zobrist key, the keys
+ *	of every square it empties or fills. XOR it into sskZobristKeyForPiecesInPosition() of the
+ *	position before the move to get the one after it, or back out to take the move back.
+ *
+ *	@param undoRecord The record filled when the move was played.
+ *
+ *	@return The key delta of the move.
+ */
+sskZobristKey sskZobristKeyForMove(const sskUndoRecord * undoRecord);
+
+/**
+ *	Function returns the change a played move makes to the material key, non zero only for
+ *	captures and promotions. Add it to the key before the move, subtract it to take the move back.
+ *
+ *	@param undoRecord The record filled when the move was played.
+ *
+ *	@return The material key delta of the move, modulo 2^64.
+ */
+sskMaterialKey sskMaterialKeyForMove(const sskUndoRecord * undoRecord);
+
+#pragma mark - Castling rights functions
+
+/**
+ *	Function converts an xFEN castling status to a castling rights mask.
+ *
+ *	@param castlingStatus The castling status of a move, "KQkq" order with '-' for a lost right.
+ *
+ *	@return The sskCastlingType bits of the rights still available.
+ */
+sskCastlingRights sskCastlingRightsFromStatus(const char castlingStatus[5]);
+
+/**
+ *	Function fills, for each square, the castling rights kept when a move starts or ends there.
+ *	The king squares clear both rights of their side and each castling rook square its own right,
+ *	so that rights &= updateMasks[fromSquare] & updateMasks[toSquare] tracks them through a game,
+ *	rooks captured at home included.
+ *
+ *	@param position The position the castling status belongs to.
+ *	@param castlingStatus The castling status, which gives the rook files for Chess960.
+ *	@param updateMasks The 64 masks to fill.
+ */
+void sskFillCastlingRightsUpdateMasks(const sskPosition * position, const char castlingStatus[5], sskCastlingRights updateMasks[64]);
+
+#pragma mark - Move generation functions
+
+/**
+ *	The side to move state that goes with a compact position, as in the last fields of an xFEN.
+ */
+typedef struct _sskPositionState {
+	sskChessColor		sideToMove;			/** Color of the side to move. */
+	char				castlingStatus[5];	/** xFEN castling status, "KQkq" order with '-' for a lost right. */
+	sskChessSquare		enPassantTarget;	/** En passant target square, 0 for none. */
+} sskPositionState;
+
+/**
+ *	A move packed into 16 bits: fromSquare in bits 0-5, toSquare in bits 6-11 and one of the
+ *	sskEncodedMoveFlag values in bits 12-15. A castling move is encoded as the king capturing its
+ *	own rook, which stays unambiguous in Chess960 positions where the king does not move.
+ */
+typedef unsigned short sskEncodedMove;
+
+enum {
+	sskEncodedMoveFlagNone				= (0x0),	/** Any other move, capture or not */
+	sskEncodedMoveFlagEnPassant			= (0x1),	/** En passant capture */
+	sskEncodedMoveFlagCastling			= (0x2),	/** Castling, toSquare is the rook's square */
+	sskEncodedMoveFlagQueenPromotion	= (0x8),	/** Promotion to a queen, capture or not */
+	sskEncodedMoveFlagRookPromotion		= (0x9),	/** Promotion to a rook */
+	sskEncodedMoveFlagBishopPromotion	= (0xA),	/** Promotion to a bishop */
+	sskEncodedMoveFlagKnightPromotion	= (0xB)		/** Promotion to a knight */
+};
+typedef unsigned short sskEncodedMoveFlag;	/** 4-bit type to represent the kind of an encoded move */
+
+#define SSK_ENCODE_MOVE(fromSquare, toSquare, flag) ((sskEncodedMove)((fromSquare) | ((toSquare) << 6) | ((flag) << 12)))
+#define SSK_GET_ENCODED_MOVE_FROM(encodedMove) ((sskChessSquare)((encodedMove) & 0x3F))
+#define SSK_GET_ENCODED_MOVE_TO(encodedMove) ((sskChessSquare)(((encodedMove) >> 6) & 0x3F))
+#define SSK_GET_ENCODED_MOVE_FLAG(encodedMove) ((sskEncodedMoveFlag)((encodedMove) >> 12))
+
+/** Generic piece code promoted to by an encoded move, sskChessPieceNone if it is no promotion. */
+#define SSK_GET_ENCODED_MOVE_PROMOTED_PIECE(encodedMove) ((SSK_GET_ENCODED_MOVE_FLAG(encodedMove) & 0x8) ? (sskChessPieceQueen + (SSK_GET_ENCODED_MOVE_FLAG(encodedMove) & 0x3)) : sskChessPieceNone)
+
+/** Capacity of a legal move buffer, above the 218 moves of the richest known position. */
+#define SSK_MAX_LEGAL_MOVES 256
+
+/**
+ *	Function generates every legal move of the side to move: promotions to each piece, en passant,
+ *	castling(Chess960 included) and only the moves that respect pins and resolve checks. Nothing
+ *	is allocated, the moves are written to the caller's buffer, usually an array on the stack.
+ *
+ *	@param position The current position.
+ *	@param state The side to move, castling status and en passant target of the position.
+ *	@param buffer Out param, receives the moves. Must hold SSK_MAX_LEGAL_MOVES moves.
+ *
+ *	@return The number of legal moves, 0 on checkmate or stalemate.
+ */
+unsigned short sskGenerateLegalMoves(const sskPosition * position, const sskPositionState * state, sskEncodedMove buffer[SSK_MAX_LEGAL_MOVES]);
+
+/**
+ *	Function verifies if the side to move has at least one legal move, without generating them.
+ *	The likeliest sources are tried first, king steps to unattacked squares, then pawns, knights
+ *	and sliders free of pins set-wise, then pinned pieces, en passant and castling, and the first
+ *	hit returns. No legal move means checkmate under check and stalemate otherwise.
+ *
+ *	@param position The current position.
+ *	@param state The side to move, castling status and en passant target of the position.
+ *
+ *	@return kTrue if a legal move exists else kFalse.
+ */
+kBool sskHasLegalMove(const sskPosition * position, const sskPositionState * state);
+
 #pragma mark - Piece and board status query function
 
 /**
@@ -87,12 +497,54 @@ sskBitboardPosition * sskCheckLegal(sskBitboardPosition bitboardPosition, sskMov
  *  @param kingColor The color of the king that needs to be checked.
  *  @param shouldIncludeKing If set to TRUE, will also consider opponent king issuing check.
  *	@param checkingPieceSquare Out param, can be NULL. Filled with the square of the piece 
- *							   issuing check. In case of multiple pieces, the last piece is filled.
+ *							   issuing check. In case of multiple pieces, the one on the highest
+ *							   square is filled, use sskBitmapWithCheckingPieces() to get all of them.
  *
  *  @return The number of pieces putting the king under check or 0 for no check.
  */
 unsigned short sskIsKingUnderCheck(sskBitboardPosition bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare);
 
+/** Const pointer variant of sskIsKingUnderCheck(). */
+unsigned short sskIsKingUnderCheckRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare);
+
+/** Compact position variant of sskIsKingUnderCheck(). */
+unsigned short sskIsKingUnderCheckInPosition(const sskPosition * position, sskChessColor kingColor, kBool shouldIncludeKing, sskChessSquare * checkingPieceSquare);
+
+/**
+ *  Function returns the pieces putting a side's king under check.
+ *
+ *  @param bitboardPosition The current position in bitboard format.
+ *  @param kingColor The color of the king that needs to be checked.
+ *  @param shouldIncludeKing If set to TRUE, will also consider opponent king issuing check.
+ *
+ *  @return A bitmap with the squares of the checking pieces, empty bitmap for no check.
+ */
+sskBitmap sskBitmapWithCheckingPieces(sskBitboardPosition bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing);
+
+/** Const pointer variant of sskBitmapWithCheckingPieces(). */
+sskBitmap sskBitmapWithCheckingPiecesRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, kBool shouldIncludeKing);
+
+/** Compact position variant of sskBitmapWithCheckingPieces(). */
+sskBitmap sskBitmapWithCheckingPiecesInPosition(const sskPosition * position, sskChessColor kingColor, kBool shouldIncludeKing);
+
+/**
+ *  Function returns the squares a piece other than the king can move to in order to resolve a
+ *  check: the checking piece, plus the squares between it and the king for a slider.
+ *
+ *  @param bitboardPosition The current position in bitboard format.
+ *  @param kingColor The color of the king that needs to be checked.
+ *
+ *  @return The evasion squares. Full bitmap when the king is not under check, empty bitmap on a
+ *			double check, which only a king move resolves.
+ */
+sskBitmap sskBitmapWithCheckEvasionSquares(sskBitboardPosition bitboardPosition, sskChessColor kingColor);
+
+/** Const pointer variant of sskBitmapWithCheckEvasionSquares(). */
+sskBitmap sskBitmapWithCheckEvasionSquaresRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor);
+
+/** Compact position variant of sskBitmapWithCheckEvasionSquares(). */
+sskBitmap sskBitmapWithCheckEvasionSquaresInPosition(const sskPosition * position, sskChessColor kingColor);
+
 /**
  *	Function verifies if a side's king is under checkmate for the given position.
  *	Note that isKingUnderCheck() should be called before calling this function.
@@ -110,6 +562,12 @@ unsigned short sskIsKingUnderCheck(sskBitboardPosition bitboardPosition, sskChes
  */
 kBool sskIsKingUnderCheckMate(sskBitboardPosition bitboardPosition, sskChessColor kingColor, int numChecks, int enpassantTarget);
 
+/** Const pointer variant of sskIsKingUnderCheckMate(). */
+kBool sskIsKingUnderCheckMateRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, int numChecks, int enpassantTarget);
+
+/** Compact position variant of sskIsKingUnderCheckMate(). */
+kBool sskIsKingUnderCheckMateInPosition(const sskPosition * position, sskChessColor kingColor, int numChecks, int enpassantTarget);
+
 /**
  *	Function verifies if a side's king is under stalemate for the given position.
  *	note that checkPseudoLegal() and isKingUnderCheck() should have been called
@@ -123,6 +581,12 @@ kBool sskIsKingUnderCheckMate(sskBitboardPosition bitboardPosition, sskChessColo
  */
 kBool sskIsKingUnderStalemate(sskBitboardPosition bitboardPosition, sskChessColor kingColor, int enpassantTarget);
 
+/** Const pointer variant of sskIsKingUnderStalemate(). */
+kBool sskIsKingUnderStalemateRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor, int enpassantTarget);
+
+/** Compact position variant of sskIsKingUnderStalemate(). */
+kBool sskIsKingUnderStalemateInPosition(const sskPosition * position, sskChessColor kingColor, int enpassantTarget);
+
 /**
  *	Function checks if king can move to adjacent squares without getting into check.
  *	
@@ -133,6 +597,12 @@ kBool sskIsKingUnderStalemate(sskBitboardPosition bitboardPosition, sskChessColo
  */
 kBool sskCanKingEscape(sskBitboardPosition bitboardPosition, sskChessColor kingColor);
 
+/** Const pointer variant of sskCanKingEscape(). */
+kBool sskCanKingEscapeRef(const sskBitboardPosition * bitboardPosition, sskChessColor kingColor);
+
+/** Compact position variant of sskCanKingEscape(). */
+kBool sskCanKingEscapeInPosition(const sskPosition * position, sskChessColor kingColor);
+
 /**
  *	Function verifies whether a piece on a square can make A->B move in the given position. (Reachability)
  *	The method supports enpassant and castling verification as well. Additionaly castling is generic for
@@ -150,19 +620,30 @@ kBool sskCanKingEscape(sskBitboardPosition bitboardPosition, sskChessColor kingC
  */
 kBool sskIsSquareReachable(sskBitboardPosition bitboardPosition, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap);
 
+/** Const pointer variant of sskIsSquareReachable(). */
+kBool sskIsSquareReachableRef(const sskBitboardPosition * bitboardPosition, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap);
+
+/** Compact position variant of sskIsSquareReachable(). */
+kBool sskIsSquareReachableInPosition(const sskPosition * position, sskChessSquare fromSquare, sskChessSquare toSquare, int isCastlingOrEnpassantTarget, sskBitmap * attackMap);
+
 /**
  *	Function verifies if a particular piece under pin for the blocked piece.
  *
  *	@param bitboardPosition The position in Bitboard format.
- *	@param offsetPosition The position in Offset format.
  *	@param pinnedSquare	The square on which the probably pinned piece is sitting.
  *	@param behindSquare The square to which the pin x-ray is radiated.
  *	@param color The color of the pinned piece.
- *	@param pinCausingPieceSquare If the function returns kTrue, filled with the square number of the pinner's square.
+ *	@param pinCausingPieceSquare Out param, can be NULL. If the function returns kTrue, filled with the square number of the pinner's square.
  *
  *	@return kTrue if the given piece is under pin, kFalse if not.
  */
-kBool sskIsSquarePinned(sskBitboardPosition bitboardPosition, sskOffsetPosition offsetPosition, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare);
+kBool sskIsSquarePinned(sskBitboardPosition bitboardPosition, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare);
+
+/** Const pointer variant of sskIsSquarePinned(). */
+kBool sskIsSquarePinnedRef(const sskBitboardPosition * bitboardPosition, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare);
+
+/** Compact position variant of sskIsSquarePinned(). */
+kBool sskIsSquarePinnedInPosition(const sskPosition * position, sskChessSquare pinnedSquare, sskChessSquare behindSquare, sskChessColor color, sskChessSquare * pinCausingPieceSquare);
 
 #pragma mark - Move ambiguity handling functions
 
@@ -191,7 +672,7 @@ sskSquareCommonality sskGetSquareCommonality(sskChessSquare squares[], int numSq
  *	Function checks if the given move token is ambiguous. Additionaly, the function fills the given
  *	move token with the computed fromSquare value if the move was not ambiguos.
  *
- *	@param offsetPosition The current position in offset format for lookup.
+ *	@param offsetPosition Unused, the candidates alone decide the ambiguity. Kept for compatibility.
  *	@param reachablePiecesFromSquares An array of calculatedFromSquare.
  *	@param numReachablePieces The number of reachabe pieces found during semantic analysis. Should be > 0.
  *	@param move	The move token representing the move.
@@ -201,4 +682,30 @@ sskSquareCommonality sskGetSquareCommonality(sskChessSquare squares[], int numSq
  */
 kBool sskCheckMoveAmbiguityAndFillFromSquare(sskOffsetPosition offsetPosition, sskChessSquare reachablePiecesFromSquares[], unsigned short numReachablePieces, sskMove * move);
 
+/** Compact position variant of sskCheckMoveAmbiguityAndFillFromSquare(). position is ignored as well, it is only kept for compatibility. */
+kBool sskCheckMoveAmbiguityAndFillFromSquareInPosition(const sskPosition * position, sskChessSquare reachablePiecesFromSquares[], unsigned short numReachablePieces, sskMove * move);
+
+/**
+ *	Function returns the squares the moved piece of a move token can legally come from. It reverses
+ *	the piece's attacks from toSquare, so that the candidates come out of a single lookup, and drops
+ *	pinned pieces unless toSquare lies on their pin line. Castling is not handled here.
+ *
+ *	@param position The current position.
+ *	@param move The move token, with pieceMoved, toSquare and enPassantTarget filled.
+ *
+ *	@return A bitmap with the origin squares, empty bitmap if the piece can not reach toSquare.
+ */
+sskBitmap sskBitmapWithMoveOriginsInPosition(const sskPosition * position, const sskMove * move);
+
+/**
+ *	Function narrows the origins of a move to the file, rank or square extracted by the lexical
+ *	analyzer, and fills fromSquare when exactly one remains.
+ *
+ *	@param origins The origin squares, from sskBitmapWithMoveOriginsInPosition().
+ *	@param move The move token representing the move.
+ *
+ *	@return kTrue if ambiguous(none or several origins remain), kFalse if not ambiguous.
+ */
+kBool sskCheckMoveAmbiguityAndFillFromSquareWithOrigins(sskBitmap origins, sskMove * move);
+
 #endif
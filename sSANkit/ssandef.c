@@ -7,10 +7,15 @@
  */
 
 #include "ssandef.h"
+#include "allocation.h"
+
+#if SSK_COUNT_ALLOCATIONS
+SSK_THREAD_LOCAL unsigned long sskHeapAllocationCount = 0;
+#endif
 
 sskMove * sskCreateBlankMove() {
 	sskMove *m = NULL;
-	m = malloc(sizeof(sskMove));
+	m = SSK_MALLOC(sizeof(sskMove));
 	
 	if (m == NULL) return NULL;
 	
@@ -31,6 +36,12 @@ sskMove * sskCreateBlankMove() {
 	m->enPassantTarget = 0;
 	m->pawnHalfMoves = 0;
 	strcpy(m->castlingStatus, "----");
+	m->positionKeyBeforeMove = 0;
+	m->positionKeyAfterMove = 0;
+	m->positionRepetitions = 0;
+	m->drawStatus = sskDrawStatusNone;
+	m->materialKeyAfterMove = 0;
+	m->endgameClassAfterMove = sskEndgameClassNone;
 		
 	m->next = NULL;
 	m->prev = NULL;
@@ -12,6 +12,7 @@
 #include "chesspiece.h"
 #include "ChessSquare.h"
 #include "bool.h"
+#include "bitboard.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +30,7 @@ enum {
 	sskCastlingTypeBQSide 	=	(0x8),	// 1000
 };
 typedef unsigned short sskCastlingType; /** 4-bit type to represent castling type */
+typedef unsigned short sskCastlingRights; /** Castling types still available, bitwise OR of sskCastlingType */
 
 
 /**
@@ -59,6 +61,18 @@ enum {
 };
 typedef unsigned short sskKingStatus;
 
+/**
+ *  Enum to represent a draw by rule, reached with the position after a move.
+ */
+enum {
+	sskDrawStatusNone = 0,					/** No draw by rule */
+	sskDrawStatusThreefoldRepetition = 1,	/** Position occured a third time, draw can be claimed */
+	sskDrawStatusFiftyMoveRule = 2,			/** 50 moves without pawn move or capture, draw can be claimed */
+	sskDrawStatusFivefoldRepetition = 3,	/** Position occured a fifth time, the game is drawn */
+	sskDrawStatusSeventyFiveMoveRule = 4	/** 75 moves without pawn move or capture, the game is drawn */
+};
+typedef unsigned short sskDrawStatus;
+
 /**
  *	Structure to represent a single move token. The node is part of a doubly linked
  *	list, with a start position.
@@ -92,6 +106,7 @@ typedef struct _sskMove {
 	sskChessSquare		enPassantTarget;	/** If an enpassant is possible, set to that square */
 	unsigned short		pawnHalfMoves;		/** 50-move draw rule pawn half moves */
 	char				castlingStatus[5];	/** 4-chars, indicates 'HAha'(xFEN files) or '-' */
+	sskZobristKey		positionKeyBeforeMove;	/** Zobrist key of the position, side to move, castling and en passant above. */
 	
 	// Status Variables at the instant after the move
 	char				piecePlacementAfterMove[65];
@@ -100,6 +115,11 @@ typedef struct _sskMove {
 	 *	a1=0, h8=63 and piecePlacement[64] = '\0'. '1' indicates empty square.
 	 *	FEN symbols kqrbnp and KQRBNP are used to represent pieces.
 	 */
+	sskZobristKey		positionKeyAfterMove;	/** Zobrist key of the position after the move, with the opponent to move. */
+	unsigned short		positionRepetitions;	/** Occurences of the position after the move, this one included */
+	sskDrawStatus		drawStatus;				/** Draw by rule reached after the move */
+	sskMaterialKey		materialKeyAfterMove;	/** Piece counts after the move */
+	sskEndgameClass		endgameClassAfterMove;	/** Endgame class of the material after the move */
 
 	struct _sskMove *		next; /** Pointer to the next move */
 	struct _sskMove *		prev; /** Pointer to the previous move */